@@ -0,0 +1,177 @@
+#ifdef BOT_ALLOC_TRACKING
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <new>
+
+#include "AllocTracker.h"
+
+// The counters are only touched from the control thread so they need no
+// locking. The thread flag and current stage are thread local, which keeps
+// ROS's own worker threads out of the numbers.
+static __thread bool isControlThread = false;
+static __thread int currentStage = STAGE_OTHER;
+
+static unsigned long stageCount[STAGE_COUNT];
+static unsigned long stageBytes[STAGE_COUNT];
+static unsigned long lastTickCount[STAGE_COUNT];
+
+static bool strictMode = false;
+static int warmupTicksLeft = 0;
+static unsigned long tickNumber = 0;
+
+static const char* stageNames[STAGE_COUNT] = {
+  "other", "decode", "fuse", "fsm", "actuate", "telemetry", "transport"
+};
+
+static bool StageChecked(int stage){
+  return stage != STAGE_OTHER and stage != STAGE_TRANSPORT;
+}
+
+static inline void CountAllocation(size_t size){
+  if(isControlThread){
+    stageCount[currentStage]++;
+    stageBytes[currentStage] += size;
+  }
+}
+
+//===========================================================================
+// Allocation hooks
+//===========================================================================
+#ifdef __GLIBC__
+extern "C" {
+  void* __libc_malloc(size_t size);
+  void* __libc_calloc(size_t n, size_t size);
+  void* __libc_realloc(void* ptr, size_t size);
+  void __libc_free(void* ptr);
+
+  void* malloc(size_t size){
+    CountAllocation(size);
+    return __libc_malloc(size);
+  }
+
+  void* calloc(size_t n, size_t size){
+    CountAllocation(n*size);
+    return __libc_calloc(n, size);
+  }
+
+  void* realloc(void* ptr, size_t size){
+    CountAllocation(size);
+    return __libc_realloc(ptr, size);
+  }
+
+  void free(void* ptr){
+    __libc_free(ptr);
+  }
+}
+#define RAW_MALLOC __libc_malloc
+#define RAW_FREE __libc_free
+#else
+#define RAW_MALLOC malloc
+#define RAW_FREE free
+#endif
+
+void* operator new(size_t size){
+  CountAllocation(size);
+  void* ptr = RAW_MALLOC(size == 0 ? 1 : size);
+  if(ptr == NULL)
+    throw std::bad_alloc();
+  return ptr;
+}
+
+void* operator new[](size_t size){
+  CountAllocation(size);
+  void* ptr = RAW_MALLOC(size == 0 ? 1 : size);
+  if(ptr == NULL)
+    throw std::bad_alloc();
+  return ptr;
+}
+
+void* operator new(size_t size, const std::nothrow_t&) throw(){
+  CountAllocation(size);
+  return RAW_MALLOC(size == 0 ? 1 : size);
+}
+
+void* operator new[](size_t size, const std::nothrow_t&) throw(){
+  CountAllocation(size);
+  return RAW_MALLOC(size == 0 ? 1 : size);
+}
+
+void operator delete(void* ptr) throw(){
+  RAW_FREE(ptr);
+}
+
+void operator delete[](void* ptr) throw(){
+  RAW_FREE(ptr);
+}
+
+void operator delete(void* ptr, size_t) throw(){
+  RAW_FREE(ptr);
+}
+
+void operator delete[](void* ptr, size_t) throw(){
+  RAW_FREE(ptr);
+}
+
+//===========================================================================
+// Stage bookkeeping
+//===========================================================================
+void AllocTrackerInit(){
+  isControlThread = true;
+  currentStage = STAGE_OTHER;
+}
+
+int AllocTrackerSetStage(int stage){
+  int previous = currentStage;
+  currentStage = stage;
+  return previous;
+}
+
+void AllocTrackerSetStrict(int warmupTicks){
+  strictMode = true;
+  warmupTicksLeft = warmupTicks;
+}
+
+void AllocTrackerEndTick(){
+  tickNumber++;
+
+  if(strictMode and warmupTicksLeft > 0){
+    warmupTicksLeft--;
+  }
+  else if(strictMode){
+    bool failed = false;
+    for(int i = 0; i < STAGE_COUNT; i++){
+      if(StageChecked(i) and stageCount[i] != lastTickCount[i]){
+	fprintf(stderr, "AllocTracker: stage '%s' made %lu allocation(s) in tick %lu\n",
+		stageNames[i], stageCount[i] - lastTickCount[i], tickNumber);
+	failed = true;
+      }
+    }
+    if(failed){
+      AllocTrackerReport();
+      abort();
+    }
+  }
+
+  for(int i = 0; i < STAGE_COUNT; i++)
+    lastTickCount[i] = stageCount[i];
+}
+
+unsigned long AllocTrackerCount(int stage){
+  return stageCount[stage];
+}
+
+unsigned long AllocTrackerBytes(int stage){
+  return stageBytes[stage];
+}
+
+void AllocTrackerReport(){
+  fprintf(stderr, "AllocTracker: %lu ticks\n", tickNumber);
+  for(int i = 0; i < STAGE_COUNT; i++){
+    double perTick = tickNumber > 0 ? stageCount[i] / (double)tickNumber : 0.;
+    fprintf(stderr, "  %-10s %10lu allocs %12lu bytes %8.2f allocs/tick\n",
+	    stageNames[i], stageCount[i], stageBytes[i], perTick);
+  }
+}
+
+#endif
@@ -0,0 +1,74 @@
+#ifndef ALLOC_TRACKER_H
+#define ALLOC_TRACKER_H
+
+// Heap allocation accounting for the control loop.
+//
+// When built with BOT_ALLOC_TRACKING the global operator new (and malloc on
+// glibc) are hooked and every allocation made on the control thread is
+// charged to the pipeline stage that is currently active. Without the define
+// all of this compiles away to nothing, except that asking for strict mode
+// says it is being ignored.
+
+enum PipelineStage{
+  STAGE_OTHER = 0,   // ROS spinning and anything not attributed below
+  STAGE_DECODE,      // sensor callbacks
+  STAGE_FUSE,        // blob merging and stimuli assembly
+  STAGE_FSM,         // UpdateBehaviour / ExecuteBehaviour
+  STAGE_ACTUATE,     // wheel and servo messages
+  STAGE_TELEMETRY,   // console output
+  STAGE_TRANSPORT,   // roscpp serialising publish() and service calls
+  STAGE_COUNT
+};
+
+#ifdef BOT_ALLOC_TRACKING
+
+// Marks the calling thread as the control thread. Only allocations made on
+// this thread are counted.
+void AllocTrackerInit();
+
+// Returns the previously active stage. ALLOC_STAGE restores it on scope
+// exit, ALLOC_SET_STAGE simply switches.
+int AllocTrackerSetStage(int stage);
+
+// Called once at the end of every control tick. In strict mode any stage
+// that allocates after the warm up ticks aborts the process with a report.
+// STAGE_OTHER and STAGE_TRANSPORT are counted but not checked: roscpp
+// allocates a buffer for every message it serialises, which the controller
+// cannot avoid short of bypassing ROS.
+void AllocTrackerEndTick();
+void AllocTrackerSetStrict(int warmupTicks);
+
+unsigned long AllocTrackerCount(int stage);
+unsigned long AllocTrackerBytes(int stage);
+void AllocTrackerReport();
+
+class AllocStageScope{
+ public:
+  AllocStageScope(int stage){ previous = AllocTrackerSetStage(stage); };
+  ~AllocStageScope(){ AllocTrackerSetStage(previous); };
+ private:
+  int previous;
+};
+
+#define ALLOC_STAGE_CAT2(a, b) a##b
+#define ALLOC_STAGE_CAT(a, b) ALLOC_STAGE_CAT2(a, b)
+#define ALLOC_STAGE(stage) AllocStageScope ALLOC_STAGE_CAT(allocStage_, __LINE__)(stage)
+#define ALLOC_SET_STAGE(stage) AllocTrackerSetStage(stage)
+
+#else
+
+#include <stdio.h>
+
+inline void AllocTrackerInit(){};
+inline void AllocTrackerEndTick(){};
+inline void AllocTrackerSetStrict(int warmupTicks){
+  printf("--alloc-strict needs a BOT_ALLOC_TRACKING build, ignored\n");
+};
+inline void AllocTrackerReport(){};
+
+#define ALLOC_STAGE(stage)
+#define ALLOC_SET_STAGE(stage)
+
+#endif
+
+#endif
@@ -0,0 +1,361 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#include "BlobDetector.h"
+
+void DefaultBlobDetectorConfig(BlobDetectorConfig& config){
+  // The red of the markers on the BuPiGo bodies in the scene
+  config.lower[0] = 150;
+  config.lower[1] = 0;
+  config.lower[2] = 0;
+  config.upper[0] = 255;
+  config.upper[1] = 90;
+  config.upper[2] = 90;
+  config.minArea = 4;
+  config.pyramidLevels = 0;
+}
+
+bool ParseBlobDetectorOption(const char* arg, BlobDetectorConfig& config){
+  if(strncmp(arg, "--raw-omni-color=", 17) == 0){
+    int v[6];
+    if(sscanf(arg + 17, "%d,%d,%d,%d,%d,%d", &v[0], &v[1], &v[2], &v[3], &v[4], &v[5]) != 6){
+      printf("--raw-omni-color needs six values, r0,g0,b0,r1,g1,b1\n");
+      return true;
+    }
+    for(int c = 0; c < 3; c++){
+      config.lower[c] = v[c];
+      config.upper[c] = v[c + 3];
+    }
+  }
+  else if(strncmp(arg, "--raw-omni-min-area=", 20) == 0){
+    config.minArea = atoi(arg + 20);
+  }
+  else if(strncmp(arg, "--raw-omni-pyramid=", 19) == 0){
+    config.pyramidLevels = atoi(arg + 19);
+    if(config.pyramidLevels < 0 or config.pyramidLevels > 2){
+      printf("--raw-omni-pyramid is 0, 1 or 2, using 0\n");
+      config.pyramidLevels = 0;
+    }
+  }
+  else{
+    return false;
+  }
+  return true;
+}
+
+//===========================================================================
+// Thresholding
+//===========================================================================
+void MakeThresholdPattern(const BlobDetectorConfig& config, ThresholdPattern& pattern){
+  for(int i = 0; i < 48; i++){
+    pattern.lower[i] = config.lower[i % 3];
+    pattern.upper[i] = config.upper[i % 3];
+  }
+}
+
+void ThresholdRowScalar(const uint8_t* rgb, int width, const ThresholdPattern& pattern,
+			uint8_t* mask){
+  const uint8_t* lower = pattern.lower;
+  const uint8_t* upper = pattern.upper;
+  for(int x = 0; x < width; x++){
+    const uint8_t* pixel = rgb + 3*x;
+    mask[x] = pixel[0] >= lower[0] and pixel[0] <= upper[0] and
+      pixel[1] >= lower[1] and pixel[1] <= upper[1] and
+      pixel[2] >= lower[2] and pixel[2] <= upper[2];
+  }
+}
+
+void ThresholdRow(const uint8_t* rgb, int width, const ThresholdPattern& pattern,
+		  uint8_t* mask){
+  int x = 0;
+#ifdef __SSE2__
+  // Sixteen pixels are 48 bytes, three registers whose channel order
+  // repeats every three bytes. Each byte is tested against its channel's
+  // bounds with saturating subtracts, which leaves zero only inside the
+  // box, and the three byte masks become one 48 bit word in which a pixel
+  // is inside if its three consecutive bits are all set.
+  __m128i lo[3];
+  __m128i hi[3];
+  for(int r = 0; r < 3; r++){
+    lo[r] = _mm_loadu_si128((const __m128i*)(pattern.lower + 16*r));
+    hi[r] = _mm_loadu_si128((const __m128i*)(pattern.upper + 16*r));
+  }
+  const __m128i zero = _mm_setzero_si128();
+  const uint64_t everyThird = 0x249249249249ull;
+
+  for(; x + 16 <= width; x += 16){
+    uint64_t bits = 0;
+    for(int r = 0; r < 3; r++){
+      __m128i value = _mm_loadu_si128((const __m128i*)(rgb + 3*x + 16*r));
+      __m128i outside = _mm_or_si128(_mm_subs_epu8(lo[r], value),
+				     _mm_subs_epu8(value, hi[r]));
+      uint64_t inside = _mm_movemask_epi8(_mm_cmpeq_epi8(outside, zero));
+      bits |= inside << (16*r);
+    }
+    bits &= (bits >> 1) & (bits >> 2) & everyThird;
+
+    // Background is by far the common case
+    if(bits == 0){
+      _mm_storeu_si128((__m128i*)(mask + x), zero);
+      continue;
+    }
+    for(int p = 0; p < 16; p++)
+      mask[x + p] = (bits >> (3*p)) & 1;
+  }
+#endif
+  ThresholdRowScalar(rgb + 3*x, width - x, pattern, mask + x);
+}
+
+//===========================================================================
+// Components
+//===========================================================================
+BlobDetector::BlobDetector(){
+  BlobDetectorConfig defaults;
+  DefaultBlobDetectorConfig(defaults);
+  SetConfig(defaults);
+};
+
+BlobDetector::BlobDetector(const BlobDetectorConfig& config){
+  SetConfig(config);
+};
+
+void BlobDetector::SetConfig(const BlobDetectorConfig& config){
+  this->config = config;
+  MakeThresholdPattern(config, pattern);
+};
+
+int BlobDetector::Detect(const uint8_t* image, int width, int height, int step,
+			 vector<float>& packet){
+
+  packet.resize(kBlobPacketHeader);
+  packet[0] = 0;
+  packet[1] = kBlobPacketDatum;
+  packet[2] = 0;
+  if(width <= 0 or height <= 0)
+    return 0;
+
+  regions.clear();
+  if(config.pyramidLevels > 0){
+    FindCandidates(image, width, height, step);
+  }
+  else{
+    Region whole = {0, 0, width, height};
+    regions.push_back(whole);
+  }
+
+  components.clear();
+  for(size_t r = 0; r < regions.size(); r++){
+    ThresholdRegion(image, step, regions[r]);
+    LabelMask(regions[r].x1 - regions[r].x0, regions[r].y1 - regions[r].y0,
+	      regions[r].x0, regions[r].y0);
+  }
+
+  int blobs = 0;
+  for(size_t c = 0; c < components.size(); c++){
+    const Component& component = components[c];
+    if(component.area < config.minArea)
+      continue;
+
+    double area = component.area;
+    double cx = component.sumX / area;
+    double cy = component.sumY / area;
+    double mu20 = component.sumXX / area - cx*cx;
+    double mu02 = component.sumYY / area - cy*cy;
+    double mu11 = component.sumXY / area - cx*cy;
+
+    packet.resize(kBlobPacketHeader + (blobs + 1)*kBlobPacketDatum);
+    float* blob = &packet[kBlobPacketHeader + blobs*kBlobPacketDatum];
+    blob[0] = area / ((double)width*height);
+    // Rows run top down, the blob filter's y bottom up
+    blob[1] = -0.5 * atan2(2.*mu11, mu20 - mu02);
+    blob[2] = (cx + 0.5) / width;
+    blob[3] = 1. - (cy + 0.5) / height;
+    blob[4] = (component.maxX - component.minX + 1) / (float)width;
+    blob[5] = (component.maxY - component.minY + 1) / (float)height;
+    blobs++;
+  }
+
+  packet[0] = blobs;
+  return blobs;
+};
+
+void BlobDetector::ThresholdRegion(const uint8_t* image, int step, const Region& region){
+  int width = region.x1 - region.x0;
+  int height = region.y1 - region.y0;
+  mask.resize(width*height);
+  for(int y = 0; y < height; y++)
+    ThresholdRow(image + (region.y0 + y)*step + 3*region.x0, width, pattern,
+		 &mask[y*width]);
+};
+
+// Coarse pass of the pyramid: fills regions with the full resolution
+// rectangles around everything seen in the sampled rows
+void BlobDetector::FindCandidates(const uint8_t* image, int width, int height, int step){
+  int factor = 1 << config.pyramidLevels;
+  int coarseWidth = (width + factor - 1) / factor;
+  int coarseHeight = (height + factor - 1) / factor;
+
+  row.resize(width);
+  mask.resize(coarseWidth*coarseHeight);
+  for(int cy = 0; cy < coarseHeight; cy++){
+    ThresholdRow(image + cy*factor*step, width, pattern, &row[0]);
+    uint8_t* coarse = &mask[cy*coarseWidth];
+    memset(coarse, 0, coarseWidth);
+
+    // Mark the coarse pixels under each run, most rows have none
+    const uint8_t* line = &row[0];
+    int x = 0;
+    while(x < width){
+      const uint8_t* next = (const uint8_t*)memchr(line + x, 1, width - x);
+      if(next == NULL)
+	break;
+      x = next - line;
+      int x0 = x;
+      while(x < width and line[x])
+	x++;
+      memset(coarse + x0 / factor, 1, (x - 1) / factor - x0 / factor + 1);
+    }
+  }
+
+  components.clear();
+  LabelMask(coarseWidth, coarseHeight, 0, 0);
+
+  // Grow each candidate by a coarse pixel all round, then merge
+  // overlapping rectangles until none overlap
+  for(size_t c = 0; c < components.size(); c++){
+    const Component& component = components[c];
+    Region region;
+    // Widened to whole 16 pixel steps of ThresholdRow
+    region.x0 = (component.minX - 1)*factor & ~15;
+    region.y0 = (component.minY - 1)*factor;
+    region.x1 = ((component.maxX + 2)*factor + 15) & ~15;
+    region.y1 = (component.maxY + 2)*factor;
+    if(region.x0 < 0) region.x0 = 0;
+    if(region.y0 < 0) region.y0 = 0;
+    if(region.x1 > width) region.x1 = width;
+    if(region.y1 > height) region.y1 = height;
+
+    bool merged = true;
+    while(merged){
+      merged = false;
+      for(size_t r = 0; r < regions.size(); r++){
+	const Region& other = regions[r];
+	if(other.x0 < region.x1 and region.x0 < other.x1 and
+	   other.y0 < region.y1 and region.y0 < other.y1){
+	  if(other.x0 < region.x0) region.x0 = other.x0;
+	  if(other.y0 < region.y0) region.y0 = other.y0;
+	  if(other.x1 > region.x1) region.x1 = other.x1;
+	  if(other.y1 > region.y1) region.y1 = other.y1;
+	  regions[r] = regions.back();
+	  regions.pop_back();
+	  merged = true;
+	  break;
+	}
+      }
+    }
+    regions.push_back(region);
+  }
+};
+
+int BlobDetector::FindRoot(int run){
+  while(runs[run].parent != run){
+    runs[run].parent = runs[runs[run].parent].parent;
+    run = runs[run].parent;
+  }
+  return run;
+};
+
+void BlobDetector::LabelMask(int width, int height, int offsetX, int offsetY){
+  runs.clear();
+
+  // Runs of each row, joined to the runs of the row above that they touch,
+  // diagonals included
+  int previousBegin = 0;
+  int previousEnd = 0;
+  for(int y = 0; y < height; y++){
+    const uint8_t* line = &mask[y*width];
+    int rowBegin = runs.size();
+    int above = previousBegin;
+
+    int x = 0;
+    while(x < width){
+      const uint8_t* next = (const uint8_t*)memchr(line + x, 1, width - x);
+      if(next == NULL)
+	break;
+      x = next - line;
+      int x0 = x;
+      while(x < width and line[x])
+	x++;
+
+      Run run;
+      run.y = y;
+      run.x0 = x0;
+      run.x1 = x - 1;
+      run.parent = runs.size();
+      runs.push_back(run);
+      int current = runs.size() - 1;
+
+      while(above < previousEnd and runs[above].x1 + 1 < x0)
+	above++;
+      for(int a = above; a < previousEnd and runs[a].x0 <= run.x1 + 1; a++){
+	int rootA = FindRoot(a);
+	int rootB = FindRoot(current);
+	// The earlier run stays the root, so components come out in the
+	// order they are first seen
+	if(rootA < rootB)
+	  runs[rootB].parent = rootA;
+	else if(rootB < rootA)
+	  runs[rootA].parent = rootB;
+      }
+    }
+
+    previousBegin = rowBegin;
+    previousEnd = runs.size();
+  }
+
+  // Sum each run into its component. Links only ever point to earlier
+  // runs, so walking forward each run's link has already been replaced by
+  // its component, encoded as -1 - index, and a run that still links to
+  // itself is a root and starts a new component.
+  int numRuns = runs.size();
+  for(int r = 0; r < numRuns; r++){
+    int link = runs[r].parent;
+    int index;
+    if(link == r){
+      index = components.size();
+      Component empty = {0, 0., 0., 0., 0., 0., offsetX + width, -1, offsetY + height, -1};
+      components.push_back(empty);
+    }
+    else{
+      index = -1 - runs[link].parent;
+    }
+    runs[r].parent = -1 - index;
+
+    const Run& run = runs[r];
+    Component& component = components[index];
+    double x0 = run.x0 + offsetX;
+    double x1 = run.x1 + offsetX;
+    double y = run.y + offsetY;
+    double n = x1 - x0 + 1.;
+    double sumX = (x0 + x1) * n / 2.;
+    // Sum of x^2 over x0..x1
+    double sumXX = (x1*(x1 + 1.)*(2.*x1 + 1.) - (x0 - 1.)*x0*(2.*x0 - 1.)) / 6.;
+
+    component.area += n;
+    component.sumX += sumX;
+    component.sumY += y * n;
+    component.sumXX += sumXX;
+    component.sumYY += y * y * n;
+    component.sumXY += y * sumX;
+    if(run.x0 + offsetX < component.minX) component.minX = run.x0 + offsetX;
+    if(run.x1 + offsetX > component.maxX) component.maxX = run.x1 + offsetX;
+    if(run.y + offsetY < component.minY) component.minY = run.y + offsetY;
+    if(run.y + offsetY > component.maxY) component.maxY = run.y + offsetY;
+  }
+};
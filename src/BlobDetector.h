@@ -0,0 +1,141 @@
+#ifndef BLOB_DETECTOR_H
+#define BLOB_DETECTOR_H
+
+#include <stdint.h>
+#include <vector>
+
+using namespace std;
+
+// Blob detection on raw omni camera images, done in the controller instead
+// of by V-REP's blob filter so the cost lands on the robot's own process
+// rather than on the simulator's single thread.
+//
+// An RGB8 image is thresholded row by row against a colour box (SSE2, 16
+// pixels per step, with a scalar reference) and the foreground is split
+// into 8-connected components. Components are labelled on runs rather than
+// pixels: each row's foreground is cut into runs, a run is joined
+// (union-find) to every run it touches in the row above, and area,
+// moments and bounding box are summed per run in closed form. Each
+// component of at least minArea pixels becomes one blob, written in the
+// layout of the blob filter's packet so BotController::OmniPacket decodes
+// it unchanged:
+//
+//   [0] blob count, [1] values per blob (6), [2] unused, then for blob i at
+//   3 + 6i: relative area, orientation, x, y, width, height
+//
+// with positions and sizes relative to the image (0..1) and the
+// orientation of the blob's major axis in radians, counter clockwise from
+// the x axis. Like the blob filter's, positions are from the bottom left
+// corner: x to the right, y up. The V-REP ROS plugin publishes the image
+// flipped, top row first, so y is 1 less the row's fraction of the height.
+//
+// With pyramidLevels = L > 0 only every 2^L th row is thresholded, and
+// each group of 2^L pixels in it is reduced to one coarse pixel that is
+// set if any of them is. Labelling the coarse mask gives candidate
+// regions, which are grown by 2^L pixels on every side, merged where they
+// overlap and then thresholded and labelled at full resolution. A compact
+// marker at least 2^L pixels tall is always found and comes out as it
+// would without the pyramid, though specks thinner than that can be
+// missed. The coarse pass costs a fraction of a full one, so this pays
+// while the markers cover a small part of the image (2-4x on an empty
+// one); with dozens of markers in view the full resolution pass is faster.
+
+const int kBlobPacketHeader = 3;
+const int kBlobPacketDatum = 6;
+
+struct BlobDetectorConfig{
+  uint8_t lower[3];     // inclusive RGB lower bound of a team mate's marker
+  uint8_t upper[3];     // inclusive RGB upper bound
+  int minArea;          // pixels, smaller components are noise
+  int pyramidLevels;    // 0 full resolution, 1 or 2 for a 2x or 4x coarse pass
+};
+
+void DefaultBlobDetectorConfig(BlobDetectorConfig& config);
+
+// Parses --raw-omni-color=r0,g0,b0,r1,g1,b1, --raw-omni-min-area=N and
+// --raw-omni-pyramid=L. Returns false if the argument is not a detector
+// flag.
+bool ParseBlobDetectorOption(const char* arg, BlobDetectorConfig& config);
+
+// The colour box repeated over 16 RGB pixels, the form ThresholdRow
+// compares whole registers against
+struct ThresholdPattern{
+  uint8_t lower[48];
+  uint8_t upper[48];
+};
+
+void MakeThresholdPattern(const BlobDetectorConfig& config, ThresholdPattern& pattern);
+
+// Writes 1 to mask for every pixel of the row inside the colour box, 0
+// otherwise. ThresholdRowScalar is the reference version.
+void ThresholdRow(const uint8_t* rgb, int width, const ThresholdPattern& pattern,
+		  uint8_t* mask);
+void ThresholdRowScalar(const uint8_t* rgb, int width, const ThresholdPattern& pattern,
+			uint8_t* mask);
+
+class BlobDetector{
+
+ public:
+
+  BlobDetector();
+  BlobDetector(const BlobDetectorConfig& config);
+
+  void SetConfig(const BlobDetectorConfig& config);
+
+  // Detects the blobs in an RGB8 image with rows step bytes apart and
+  // writes them to packet. Returns the number of blobs. The buffers are
+  // kept between calls, so images of a steady size do not allocate.
+  int Detect(const uint8_t* image, int width, int height, int step,
+	     vector<float>& packet);
+
+ private:
+
+  // A horizontal stretch of foreground, x0..x1 inclusive
+  struct Run{
+    int y;
+    int x0;
+    int x1;
+    int parent;         // union-find link to an earlier run
+  };
+
+  struct Component{
+    int area;
+    double sumX;
+    double sumY;
+    double sumXX;
+    double sumYY;
+    double sumXY;
+    int minX;
+    int maxX;
+    int minY;
+    int maxY;
+  };
+
+  // Full resolution rectangle to threshold and label, x0..x1 and y0..y1
+  // exclusive of the ends
+  struct Region{
+    int x0;
+    int y0;
+    int x1;
+    int y1;
+  };
+
+  void ThresholdRegion(const uint8_t* image, int step, const Region& region);
+  void FindCandidates(const uint8_t* image, int width, int height, int step);
+
+  // Labels a width x height mask whose top left pixel is at offsetX,
+  // offsetY in the image, appending its components
+  void LabelMask(int width, int height, int offsetX, int offsetY);
+  int FindRoot(int run);
+
+  BlobDetectorConfig config;
+  ThresholdPattern pattern;
+
+  vector<uint8_t> mask;
+  vector<uint8_t> row;
+  vector<Run> runs;
+  vector<Component> components;
+  vector<Region> regions;
+};
+
+#endif
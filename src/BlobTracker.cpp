@@ -0,0 +1,217 @@
+#include <math.h>
+
+#include "BlobTracker.h"
+
+static float WrapAngle(float angle){
+  while(angle > M_PI)
+    angle -= 2.*M_PI;
+  while(angle <= -M_PI)
+    angle += 2.*M_PI;
+  return angle;
+}
+
+// Range against log2(area) from kRangeTableMinLog2 in half octave steps,
+// measured with botSwarmSim's camera model (blob size 0.5 robot diameters
+// over range, robot diameter 0.12 m). Re-measure for another camera.
+static const float kRangeTableMinLog2 = -12.;
+static const float kRangeTableStep = 0.5;
+static const int kRangeTableSize = 25;
+static const float kRangeTable[kRangeTableSize] = {
+  3.8400, 3.2290, 2.7153, 2.2833, 1.9200,
+  1.6145, 1.3576, 1.1416, 0.9600, 0.8073,
+  0.6788, 0.5708, 0.4800, 0.4036, 0.3394,
+  0.2854, 0.2400, 0.2018, 0.1697, 0.1427,
+  0.1200, 0.1009, 0.0849, 0.0714, 0.0600
+};
+
+float RangeFromArea(float area){
+  if(area <= 0.)
+    return kRangeTable[0];
+
+  float position = (log2(area) - kRangeTableMinLog2) / kRangeTableStep;
+  if(position <= 0.)
+    return kRangeTable[0];
+  if(position >= kRangeTableSize - 1)
+    return kRangeTable[kRangeTableSize - 1];
+
+  int index = position;
+  float fraction = position - index;
+  return kRangeTable[index] + fraction * (kRangeTable[index + 1] - kRangeTable[index]);
+}
+
+BlobTracker::BlobTracker(){
+  Reset();
+};
+
+void BlobTracker::Reset(){
+  trackCount = 0;
+  nextId = 0;
+  lastTime = 0.;
+  haveTime = false;
+};
+
+void BlobTracker::Update(const vector<blobClass*>& blobs, float time){
+
+  int numBlobs = blobs.size();
+  int blobCount = numBlobs < kMaxTracks ? numBlobs : kMaxTracks;
+  float dt = haveTime ? time - lastTime : 0.;
+  lastTime = time;
+  haveTime = true;
+
+  // Predict
+  if(dt > 0.){
+    for(int t = 0; t < trackCount; t++){
+      tracks[t].bearing = WrapAngle(tracks[t].bearing + tracks[t].bearingRate * dt);
+      tracks[t].range += tracks[t].rangeRate * dt;
+    }
+  }
+
+  // Gate every track/blob pair. Logs are taken once per blob and track
+  // rather than per pair.
+  for(int b = 0; b < blobCount; b++){
+    blobMatched[b] = false;
+    blobLogArea[b] = blobs[b]->blobArea > 0. ? log(blobs[b]->blobArea) : 0.;
+    blobRange[b] = RangeFromArea(blobs[b]->blobArea);
+  }
+
+  int candidateCount = 0;
+  for(int t = 0; t < trackCount; t++){
+    trackMatched[t] = false;
+    float trackLogArea = tracks[t].area > 0. ? log(tracks[t].area) : 0.;
+    for(int b = 0; b < blobCount; b++){
+      float bearingCost = fabs(WrapAngle(blobs[b]->blobBearing - tracks[t].bearing))
+	/ kTrackGateBearing;
+      if(bearingCost >= 1.)
+	continue;
+      float areaCost = 0.;
+      if(blobs[b]->blobArea > 0. and tracks[t].area > 0.)
+	areaCost = fabs(blobLogArea[b] - trackLogArea) / kTrackGateArea;
+      if(bearingCost + areaCost >= 1.)
+	continue;
+
+      Candidate& candidate = candidates[candidateCount++];
+      candidate.cost = bearingCost + areaCost;
+      candidate.track = t;
+      candidate.blob = b;
+    }
+  }
+  // Insertion sort, the gate leaves few candidates per blob
+  for(int i = 1; i < candidateCount; i++){
+    Candidate candidate = candidates[i];
+    int j = i - 1;
+    while(j >= 0 and candidates[j].cost > candidate.cost){
+      candidates[j + 1] = candidates[j];
+      j--;
+    }
+    candidates[j + 1] = candidate;
+  }
+
+  // Greedy assignment, cheapest pair first, with alpha-beta correction
+  for(int i = 0; i < candidateCount; i++){
+    int t = candidates[i].track;
+    int b = candidates[i].blob;
+    if(trackMatched[t] or blobMatched[b])
+      continue;
+    trackMatched[t] = true;
+    blobMatched[b] = true;
+
+    BlobTrack& track = tracks[t];
+    float residual = WrapAngle(blobs[b]->blobBearing - track.bearing);
+    track.bearing = WrapAngle(track.bearing + kTrackAlpha * residual);
+    if(dt > 0.)
+      track.bearingRate += kTrackBeta * residual / dt;
+    track.area += kTrackAlpha * (blobs[b]->blobArea - track.area);
+
+    float rangeResidual = blobRange[b] - track.range;
+    track.range += kTrackAlpha * rangeResidual;
+    if(dt > 0.)
+      track.rangeRate += kTrackBeta * rangeResidual / dt;
+
+    track.hits++;
+    track.misses = 0;
+
+    blobs[b]->trackId = track.id;
+    blobs[b]->bearingRate = track.bearingRate;
+  }
+
+  // Age the tracks that were not seen. Removal swaps in the last track, so
+  // walk backwards to keep trackMatched lined up.
+  for(int t = trackCount - 1; t >= 0; t--){
+    if(trackMatched[t])
+      continue;
+    tracks[t].misses++;
+    if(tracks[t].misses > kTrackMaxMisses)
+      RemoveTrack(t);
+  }
+
+  // New tracks for the blobs left over
+  for(int b = 0; b < blobCount; b++){
+    if(blobMatched[b])
+      continue;
+    if(trackCount == kMaxTracks){
+      blobs[b]->trackId = -1;
+      blobs[b]->bearingRate = 0.;
+      continue;
+    }
+
+    BlobTrack& track = tracks[trackCount++];
+    track.id = nextId++;
+    track.bearing = blobs[b]->blobBearing;
+    track.bearingRate = 0.;
+    track.area = blobs[b]->blobArea;
+    track.range = blobRange[b];
+    track.rangeRate = 0.;
+    track.hits = 1;
+    track.misses = 0;
+
+    blobs[b]->trackId = track.id;
+    blobs[b]->bearingRate = 0.;
+  }
+  for(int b = blobCount; b < numBlobs; b++){
+    blobs[b]->trackId = -1;
+    blobs[b]->bearingRate = 0.;
+  }
+};
+
+bool BlobTracker::FriendInSector(float bodyBearing, float halfWidth,
+				 float magneticHeadingError){
+  for(int t = 0; t < trackCount; t++){
+    if(tracks[t].hits >= kTrackConfirmHits and
+       InSector(tracks[t], bodyBearing, halfWidth, magneticHeadingError))
+      return true;
+  }
+  return false;
+};
+
+bool BlobTracker::ClosingInSector(float bodyBearing, float halfWidth,
+				  float magneticHeadingError, float timeToContact){
+  for(int t = 0; t < trackCount; t++){
+    const BlobTrack& track = tracks[t];
+    if(track.hits < kTrackRateHits or track.misses > 0 or track.rangeRate >= 0.)
+      continue;
+    if(track.range < -track.rangeRate * timeToContact and
+       InSector(track, bodyBearing, halfWidth, magneticHeadingError))
+      return true;
+  }
+  return false;
+};
+
+bool BlobTracker::InSector(const BlobTrack& track, float bodyBearing, float halfWidth,
+			   float magneticHeadingError){
+  float offset = WrapAngle(track.bearing + magneticHeadingError - bodyBearing);
+  return fabs(offset) <= halfWidth;
+};
+
+int BlobTracker::GetTrackCount(){
+  return trackCount;
+};
+
+const BlobTrack& BlobTracker::GetTrack(int index){
+  return tracks[index];
+};
+
+void BlobTracker::RemoveTrack(int index){
+  tracks[index] = tracks[trackCount - 1];
+  trackMatched[index] = trackMatched[trackCount - 1];
+  trackCount--;
+};
@@ -0,0 +1,115 @@
+#ifndef BLOB_TRACKER_H
+#define BLOB_TRACKER_H
+
+#include <vector>
+
+#include "FSM/blobClass.h"
+
+using namespace std;
+
+// Follows team mates from one omni frame to the next, so the controller can
+// tell the robot ahead this frame is the one it was following last frame.
+//
+// Tracks live in the target heading frame the blob bearings are given in,
+// where turning the robot does not move them. Each frame every track is
+// predicted forward by its bearing rate, and blobs are assigned to tracks
+// greedily, cheapest first, among the pairs that pass the gate:
+//
+//   cost = |bearing - predicted| / kTrackGateBearing
+//        + |log(area / track area)| / kTrackGateArea   < 1
+//
+// Matched tracks are corrected with an alpha-beta filter, unmatched blobs
+// start new tracks and tracks missed for more than kTrackMaxMisses frames
+// are dropped. A track counts as a friend once it has been seen in
+// kTrackConfirmHits frames, and keeps counting while it coasts through
+// missed frames, which is what smooths friendAhead/friendBehind against
+// detections that flicker.
+//
+// Each track also follows the range to its team mate, read off the blob
+// area with RangeFromArea and filtered the same way as the bearing, and
+// from its rate a time to contact. Range is only as good as the area
+// calibration, but closing speed over a few frames is enough to see a
+// proximity hit coming.
+//
+// Storage is fixed at kMaxTracks; blobs beyond that are left untracked.
+// Update writes the track id and bearing rate back into the blobs.
+
+const int kMaxTracks = 32;
+const int kTrackConfirmHits = 2;
+const int kTrackMaxMisses = 3;
+const float kTrackGateBearing = 0.35;   // radians
+const float kTrackGateArea = 1.;        // log area ratio
+const float kTrackAlpha = 0.6;
+const float kTrackBeta = 0.2;
+
+// Frames a track must have been matched in before its range rate is used
+const int kTrackRateHits = 4;
+
+// Range in metres of a team mate whose blob covers area (in the omni
+// image's normalised units), interpolated from a lookup table in log area.
+float RangeFromArea(float area);
+
+struct BlobTrack{
+  int id;
+  float bearing;        // target heading frame, radians clockwise
+  float bearingRate;    // radians per second
+  float area;
+  float range;          // metres
+  float rangeRate;      // metres per second, negative when closing
+  int hits;             // frames the track has been matched in
+  int misses;           // consecutive frames without a match
+};
+
+class BlobTracker{
+
+ public:
+
+  BlobTracker();
+
+  void Reset();
+
+  // Associates one fused frame of blobs with the tracks. time is in
+  // seconds; a frame with the same time as the last one is still matched
+  // but leaves the bearing rates alone.
+  void Update(const vector<blobClass*>& blobs, float time);
+
+  // True if a confirmed track lies within halfWidth of the given bearing
+  // relative to the front of the robot. magneticHeadingError takes the
+  // track bearings from the target heading frame to the body frame.
+  bool FriendInSector(float bodyBearing, float halfWidth,
+		      float magneticHeadingError);
+
+  // True if a track in that sector, with a settled range rate, is closing
+  // fast enough to reach the robot within timeToContact seconds.
+  bool ClosingInSector(float bodyBearing, float halfWidth,
+		       float magneticHeadingError, float timeToContact);
+
+  int GetTrackCount();
+  const BlobTrack& GetTrack(int index);
+
+ private:
+
+  void RemoveTrack(int index);
+  bool InSector(const BlobTrack& track, float bodyBearing, float halfWidth,
+		float magneticHeadingError);
+
+  BlobTrack tracks[kMaxTracks];
+  int trackCount;
+  int nextId;
+  float lastTime;
+  bool haveTime;
+
+  // Scratch for the assignment, sized for the worst case up front
+  struct Candidate{
+    float cost;
+    short track;
+    short blob;
+  };
+  Candidate candidates[kMaxTracks * kMaxTracks];
+  bool trackMatched[kMaxTracks];
+  bool blobMatched[kMaxTracks];
+  float blobLogArea[kMaxTracks];
+  float blobRange[kMaxTracks];
+};
+
+#endif
@@ -0,0 +1,433 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <vector>
+
+#include "BotController.h"
+#include "FormationHeading.h"
+#include "HeadingEstimator.h"
+#include "FSM/FSM.h"
+#include "FSM/blobClass.h"
+
+using namespace std;
+
+static float WrapAngle(float angle){
+  while(angle > M_PI)
+    angle -= 2.*M_PI;
+  while(angle <= -M_PI)
+    angle += 2.*M_PI;
+  return angle;
+}
+
+BotController::BotController(){
+  ControllerParams defaults;
+  DefaultControllerParams(defaults);
+  Init(defaults);
+};
+
+BotController::BotController(const ControllerParams& params){
+  Init(params);
+};
+
+void BotController::Init(const ControllerParams& params){
+  fsm = new StateManager(params);
+
+  for(int i = 0; i < OMNI_SEGMENT_COUNT; i++)
+    viewBlobVector[i].reserve(kMaxViewBlobs);
+  fullBlobVector.reserve(OMNI_SEGMENT_COUNT*kMaxViewBlobs);
+
+  magneticHeadingError = 0.;
+  simulationTime = 0.;
+  headingTime = 0.;
+  omniTime = 0.;
+  trackerTime = 0.;
+  haveTrackerTime = false;
+
+  formationAxis = 0.;
+  formationAxisTime = 0.;
+  formationAxisRate = 0.;
+  haveFormationAxis = false;
+
+  frontProxSensor = false;
+  rearProxSensor = false;
+  friendLeft = false;
+  friendRight = false;
+  friendAhead = false;
+  friendBehind = false;
+  aligned = false;
+
+  sensors = SensorSnapshot();
+
+  // Proximity hits last one tick and closingFast is already filtered by
+  // the tracker, so only the flags that follow the camera frame by frame
+  // and the heading test are held
+  stimulusFilter.SetDwell(STIMULUS_ALIGNED, params.alignDwell, params.alignDwell);
+  stimulusFilter.SetDwell(STIMULUS_FRIEND_LEFT, params.friendDwell, params.friendDwell);
+  stimulusFilter.SetDwell(STIMULUS_FRIEND_RIGHT, params.friendDwell, params.friendDwell);
+  stimulusFilter.SetDwell(STIMULUS_FRIEND_AHEAD, params.friendDwell, params.friendDwell);
+  stimulusFilter.SetDwell(STIMULUS_FRIEND_BEHIND, params.friendDwell, params.friendDwell);
+
+  driveOutput.SetLimits(params.maxWheelSpeed, params.maxWheelAccel, params.servoSlewRate);
+
+  trans_speed = params.cruiseSpeed;
+  rot_speed = 0.;
+  openServo = true;
+
+  leftMotorSpeed = 0.;
+  rightMotorSpeed = 0.;
+};
+
+BotController::~BotController(){
+  delete fsm;
+};
+
+//===========================================================================
+// Sensor inputs
+//===========================================================================
+void BotController::FrontProximity(){
+  frontProxSensor = true;
+};
+
+void BotController::RearProximity(){
+  rearProxSensor = true;
+};
+
+void BotController::BodyOrientation(double yaw){
+
+  headingEstimator.Update(yaw, simulationTime);
+  magneticHeadingError = headingEstimator.GetError();
+  headingTime = simulationTime;
+
+  // Aligned within the threshold either side. Once aligned, the robot
+  // stays so until the error is alignHysteresis past the threshold, so
+  // noise around the threshold does not flip it.
+  float threshold = fsm->GetParams().alignThreshold;
+  if(aligned)
+    threshold += fsm->GetParams().alignHysteresis;
+
+  if(fabs(magneticHeadingError) > threshold)
+    aligned = false;
+  else
+    aligned = true;
+};
+
+void BotController::OmniPacket(int segment, const float* packetData, int packetLength){
+
+  int numberOfBlobs = packetData[kOmniBlobCountIndex];
+  int datumPerBlob = packetData[kOmniDatumPerBlobIndex];
+  omniTime = simulationTime;
+
+  // Never read past the end of a short packet
+  while(numberOfBlobs > 0 and
+	(numberOfBlobs - 1)*datumPerBlob + kOmniBlobHeightOffset >= packetLength)
+    numberOfBlobs--;
+
+  // If a blob is detected then a team mate is in that direction.
+  bool friendSeen = numberOfBlobs > 0;
+  if(segment == OMNI_FRONT)
+    friendAhead = friendSeen;
+  else if(segment == OMNI_BACK)
+    friendBehind = friendSeen;
+  else if(segment == OMNI_RIGHT)
+    friendRight = friendSeen;
+  else
+    friendLeft = friendSeen;
+
+  // Bearing of the camera's axis relative to the front of the robot
+  float segmentOffset = 0.;
+  if(segment == OMNI_RIGHT)
+    segmentOffset = M_PI/2.;
+  else if(segment == OMNI_LEFT)
+    segmentOffset = -M_PI/2.;
+
+  // The same rotation applied to the blob's image direction gives the unit
+  // vector of its bearing without another atan2/sincos per blob. The back
+  // camera's bearings are flipped by pi below, which negates the vector.
+  float rotation = segmentOffset - magneticHeadingError;
+  float rotationCos = cos(rotation);
+  float rotationSin = sin(rotation);
+  if(segment == OMNI_BACK){
+    rotationCos = -rotationCos;
+    rotationSin = -rotationSin;
+  }
+
+  // Record the blobs detected, overwriting the segment's previous ones
+  vector<blobClass>& blobs = viewBlobVector[segment];
+  blobs.resize(numberOfBlobs);
+
+  for(int i = 0; i < numberOfBlobs; i++){
+    blobClass * newBlob = &blobs[i];
+    
+    float blobLocalX = packetData[i*datumPerBlob + kOmniBlobXOffset];
+    float blobLocalY = packetData[i*datumPerBlob + kOmniBlobYOffset];
+    
+    float blobLocalBearing = atan2( blobLocalY, blobLocalX);
+
+    // TODO: Need to make sure magneticHeadingError's time Stamp matches or is
+    // at least local to the current time.
+    newBlob->blobBearing = blobLocalBearing - magneticHeadingError + segmentOffset;
+    if(segment == OMNI_BACK){
+      if(newBlob->blobBearing > 0.)
+	newBlob->blobBearing -= M_PI;
+      else
+	newBlob->blobBearing += M_PI;
+    }
+    newBlob->blobBearing = WrapAngle(newBlob->blobBearing);
+
+    float length = sqrt(blobLocalX*blobLocalX + blobLocalY*blobLocalY);
+    float unitX = length > 0. ? blobLocalX / length : 1.;
+    float unitY = length > 0. ? blobLocalY / length : 0.;
+    newBlob->blobCos = unitX*rotationCos - unitY*rotationSin;
+    newBlob->blobSin = unitY*rotationCos + unitX*rotationSin;
+
+    float blobWidth = packetData[i*datumPerBlob + kOmniBlobWidthOffset];
+    float blobHeight = packetData[i*datumPerBlob + kOmniBlobHeightOffset];
+    newBlob->blobArea = blobWidth*blobHeight;
+    newBlob->trackId = -1;
+    newBlob->bearingRate = 0.;
+  }
+
+  SortByBearing(blobs);
+};
+
+void BotController::SetSimulationTime(float time){
+  simulationTime = time;
+};
+
+//===========================================================================
+// Control tick
+//===========================================================================
+void BotController::FuseSensors(){
+
+  // The tracker takes one update per camera frame. Ticks in between see
+  // the same views again, and feeding them would count a frame's blobs as
+  // several hits and pull the rate estimates towards zero, so the tracks
+  // coast until the next frame and are predicted over the whole interval.
+  MergeViews();
+  if(not haveTrackerTime or omniTime != trackerTime){
+    blobTracker.Update(fullBlobVector, omniTime);
+    trackerTime = omniTime;
+    haveTrackerTime = true;
+  }
+
+  // Ahead and behind come from the confirmed tracks in the front and back
+  // quarters rather than the last packet, so a team mate that drops out of
+  // a frame or two is still there and a one frame false blob is not
+  Stimuli stimuli;
+  stimuli.Set(STIMULUS_FRONT_PROX, frontProxSensor);
+  stimuli.Set(STIMULUS_REAR_PROX, rearProxSensor);
+  stimuli.Set(STIMULUS_FRIEND_LEFT, friendLeft);
+  stimuli.Set(STIMULUS_FRIEND_RIGHT, friendRight);
+  stimuli.Set(STIMULUS_FRIEND_AHEAD,
+	      blobTracker.FriendInSector(0., M_PI/4., magneticHeadingError));
+  stimuli.Set(STIMULUS_FRIEND_BEHIND,
+	      blobTracker.FriendInSector(M_PI, M_PI/4., magneticHeadingError));
+  stimuli.Set(STIMULUS_ALIGNED, aligned);
+
+  // A team mate in the front quarter about to be run into, seen early
+  // enough to slow down instead of evading after a proximity hit
+  float closingTime = fsm->GetParams().closingTime;
+  stimuli.Set(STIMULUS_CLOSING_FAST, closingTime > 0. and
+	      blobTracker.ClosingInSector(0., M_PI/4., magneticHeadingError, closingTime));
+  sensors.stimuli = stimulusFilter.Update(stimuli, simulationTime);
+
+  sensors.magneticHeadingError = magneticHeadingError;
+  sensors.headingRate = headingEstimator.GetRate();
+  // Steering error along the line of visible team mates
+  sensors.formationHeadingError = FormationHeadingError(fullBlobVector,
+							magneticHeadingError);
+  UpdateFormationRate();
+  sensors.formationRate = formationAxisRate;
+  sensors.blobs = &fullBlobVector;
+  sensors.time = simulationTime;
+  sensors.headingTime = headingTime;
+  sensors.omniTime = omniTime;
+};
+
+// The formation error is the axis of the line less the body's heading
+// error, so with the body held still it changes at the rate the axis
+// turns; the moving states feed that forward. The axis is axial, so its
+// changes are wrapped to a half turn, and the rate is smoothed like the
+// heading rate.
+void BotController::UpdateFormationRate(){
+  float axis = WrapAngle(2.*(sensors.formationHeadingError - magneticHeadingError)) / 2.;
+
+  if(not haveFormationAxis or simulationTime < formationAxisTime)
+    formationAxisRate = 0.;
+  else if(simulationTime > formationAxisTime){
+    float dt = simulationTime - formationAxisTime;
+    float measuredRate = WrapAngle(2.*(axis - formationAxis)) / 2. / dt;
+    formationAxisRate += dt / (kHeadingRateTimeConstant + dt) * (measuredRate - formationAxisRate);
+  }
+
+  formationAxis = axis;
+  formationAxisTime = simulationTime;
+  haveFormationAxis = true;
+};
+
+void BotController::UpdateBehaviour(){
+  fsm->UpdateBehaviour(sensors);
+};
+
+void BotController::ExecuteBehaviour(){
+
+  // ExecuteBehaviour will return a translational speed, rotational speed, and a boolean
+  // to determine weather to open or close the servo.
+  fsm->ExecuteBehaviour(sensors, trans_speed, rot_speed, openServo);
+
+  // Given the translation and rotation speeds dictated by the behaviour
+  // state the output stage works out the left and right wheel motor
+  // speeds, within the wheels' speed and acceleration limits.
+  driveOutput.Update(trans_speed, rot_speed, openServo, simulationTime);
+  leftMotorSpeed = driveOutput.GetLeftSpeed();
+  rightMotorSpeed = driveOutput.GetRightSpeed();
+};
+
+void BotController::ClearProximity(){
+  frontProxSensor = false;
+  rearProxSensor = false;
+};
+
+void BotController::Tick(){
+  FuseSensors();
+  UpdateBehaviour();
+  ExecuteBehaviour();
+  ClearProximity();
+};
+
+//===========================================================================
+// Outputs
+//===========================================================================
+float BotController::GetTransSpeed(){
+  return trans_speed;
+};
+
+float BotController::GetRotSpeed(){
+  return rot_speed;
+};
+
+bool BotController::GetServoOpen(){
+  return openServo;
+};
+
+float BotController::GetServoPosition(){
+  return driveOutput.GetServoPosition();
+};
+
+float BotController::GetLeftMotorSpeed(){
+  return leftMotorSpeed;
+};
+
+float BotController::GetRightMotorSpeed(){
+  return rightMotorSpeed;
+};
+
+bool BotController::GetStimulus(int index){
+  return sensors.stimuli.Get(index);
+};
+
+const SensorSnapshot& BotController::GetSensorSnapshot(){
+  return sensors;
+};
+
+float BotController::GetMagneticHeadingError(){
+  return magneticHeadingError;
+};
+
+float BotController::GetFormationHeadingError(){
+  return sensors.formationHeadingError;
+};
+
+const vector<blobClass*>& BotController::GetBlobs(){
+  return fullBlobVector;
+};
+
+BlobTracker& BotController::GetBlobTracker(){
+  return blobTracker;
+};
+
+HeadingEstimator& BotController::GetHeadingEstimator(){
+  return headingEstimator;
+};
+
+StimulusFilter& BotController::GetStimulusFilter(){
+  return stimulusFilter;
+};
+
+DriveOutput& BotController::GetDriveOutput(){
+  return driveOutput;
+};
+
+StateManager* BotController::GetStateManager(){
+  return fsm;
+};
+
+//===========================================================================
+// Helper Functions
+//===========================================================================
+// Insertion sort, a segment rarely holds more than a handful of blobs
+void BotController::SortByBearing(vector<blobClass>& blobs){
+  int count = blobs.size();
+  for(int i = 1; i < count; i++){
+    blobClass blob = blobs[i];
+    int j = i - 1;
+    while(j >= 0 and blobs[j].blobBearing > blob.blobBearing){
+      blobs[j + 1] = blobs[j];
+      j--;
+    }
+    blobs[j + 1] = blob;
+  }
+};
+
+// k-way merge of the sorted views into fullBlobVector. A blob within
+// seamMergeAngle of the previous one but from another segment is the same
+// robot seen across a seam, and only the larger (less clipped) of the two
+// is kept. The list is circular, so the last blob is also checked against
+// the first.
+void BotController::MergeViews(){
+  float mergeAngle = fsm->GetParams().seamMergeAngle;
+  size_t next[OMNI_SEGMENT_COUNT] = {0};
+  int firstSegment = -1;
+  int lastSegment = -1;
+
+  fullBlobVector.clear();
+  while(true){
+    int segment = -1;
+    for(int s = 0; s < OMNI_SEGMENT_COUNT; s++){
+      if(next[s] < viewBlobVector[s].size() and
+	 (segment < 0 or viewBlobVector[s][next[s]].blobBearing <
+	  viewBlobVector[segment][next[segment]].blobBearing))
+	segment = s;
+    }
+    if(segment < 0)
+      break;
+
+    blobClass* blob = &viewBlobVector[segment][next[segment]++];
+
+    if(not fullBlobVector.empty() and segment != lastSegment and
+       blob->blobBearing - fullBlobVector.back()->blobBearing < mergeAngle){
+      if(blob->blobArea > fullBlobVector.back()->blobArea){
+	fullBlobVector.back() = blob;
+	lastSegment = segment;
+	if(fullBlobVector.size() == 1)
+	  firstSegment = segment;
+      }
+      continue;
+    }
+
+    if(fullBlobVector.empty())
+      firstSegment = segment;
+    fullBlobVector.push_back(blob);
+    lastSegment = segment;
+  }
+
+  // Seam across the +-pi wrap, between the back camera's two halves and
+  // its neighbours
+  int n = fullBlobVector.size();
+  if(n >= 2 and firstSegment != lastSegment and
+     fullBlobVector[0]->blobBearing + 2.*M_PI - fullBlobVector[n - 1]->blobBearing < mergeAngle){
+    if(fullBlobVector[0]->blobArea < fullBlobVector[n - 1]->blobArea)
+      fullBlobVector[0] = fullBlobVector[n - 1];
+    fullBlobVector.pop_back();
+  }
+};
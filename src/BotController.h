@@ -0,0 +1,163 @@
+#ifndef BOT_CONTROLLER_H
+#define BOT_CONTROLLER_H
+
+#include <vector>
+
+#include "FSM/FSM.h"
+#include "FSM/blobClass.h"
+#include "BlobTracker.h"
+#include "HeadingEstimator.h"
+#include "StimulusFilter.h"
+#include "DriveOutput.h"
+
+using namespace std;
+
+// The four segments of the omni-directional camera.
+enum OmniSegment{
+  OMNI_FRONT = 0,
+  OMNI_BACK,
+  OMNI_RIGHT,
+  OMNI_LEFT,
+  OMNI_SEGMENT_COUNT
+};
+
+// Layout of the blob packet produced by V-REP's blob detection filter, as
+// read by OmniPacket: [0] number of blobs, [1] values per blob, then for
+// blob i the image position at i*datumPerBlob + 5/6 and its width/height at
+// i*datumPerBlob + 7/8.
+const int kOmniBlobCountIndex = 0;
+const int kOmniDatumPerBlobIndex = 1;
+const int kOmniBlobXOffset = 5;
+const int kOmniBlobYOffset = 6;
+const int kOmniBlobWidthOffset = 7;
+const int kOmniBlobHeightOffset = 8;
+
+// Blob storage reserved per omni segment up front, so decoding a packet
+// does not allocate. A packet with more blobs still works, the view just
+// grows once.
+const int kMaxViewBlobs = 32;
+
+// Everything the robot does between its sensors and its wheels, free of
+// ROS so the same code runs in the node, the headless simulator and the
+// offline tools. Sensor inputs may arrive in any order; a tick fuses the
+// latest of them, runs the state machine and produces wheel speeds.
+class BotController{
+
+ public:
+
+  BotController();
+  BotController(const ControllerParams& params);
+  ~BotController();
+
+  //=========================================================================
+  // Sensor inputs
+  //=========================================================================
+  void FrontProximity();
+  void RearProximity();
+
+  // Yaw of the body in the world frame (radians, counter clockwise)
+  void BodyOrientation(double yaw);
+
+  // Decodes one omni camera blob packet. packetLength is the number of
+  // floats in packetData.
+  void OmniPacket(int segment, const float* packetData, int packetLength);
+
+  void SetSimulationTime(float time);
+
+  //=========================================================================
+  // Control tick
+  //=========================================================================
+
+  // Merge the blob views, debounce the stimuli and fill the tick's sensor
+  // snapshot
+  void FuseSensors();
+  // Drive the state machine from the snapshot
+  void UpdateBehaviour();
+  // Run the current state and compute the wheel speeds
+  void ExecuteBehaviour();
+  // Proximity hits are only reported while something is in range, so they
+  // are cleared once a tick has consumed them.
+  void ClearProximity();
+
+  // All of the above, in order
+  void Tick();
+
+  //=========================================================================
+  // Outputs
+  //=========================================================================
+  float GetTransSpeed();
+  float GetRotSpeed();
+  bool GetServoOpen();
+  float GetServoPosition();     // radians, slewed by DriveOutput
+  float GetLeftMotorSpeed();
+  float GetRightMotorSpeed();
+
+  bool GetStimulus(int index);
+  const SensorSnapshot& GetSensorSnapshot();
+  float GetMagneticHeadingError();
+  float GetFormationHeadingError();
+  const vector<blobClass*>& GetBlobs();
+  BlobTracker& GetBlobTracker();
+  HeadingEstimator& GetHeadingEstimator();
+  StimulusFilter& GetStimulusFilter();
+  DriveOutput& GetDriveOutput();
+
+  StateManager* GetStateManager();
+
+ private:
+
+  void Init(const ControllerParams& params);
+  void SortByBearing(vector<blobClass>& blobs);
+  void MergeViews();
+  void UpdateFormationRate();
+
+  StateManager * fsm;
+
+  // Visual Servoing Data. Each view holds its segment's blobs in place,
+  // sorted by bearing; the full vector points into the views in bearing
+  // order, with robots seen by two neighbouring segments at a seam counted
+  // once. Both are reused from tick to tick.
+  vector<blobClass> viewBlobVector[OMNI_SEGMENT_COUNT];
+  vector<blobClass*> fullBlobVector;
+  BlobTracker blobTracker;
+  HeadingEstimator headingEstimator;
+  StimulusFilter stimulusFilter;
+  DriveOutput driveOutput;
+
+  // Latest readings, with the simulation time each arrived at
+  float magneticHeadingError;
+  float simulationTime;
+  float headingTime;
+  float omniTime;
+
+  // Camera frame the tracker was last updated with
+  float trackerTime;
+  bool haveTrackerTime;
+
+  // Formation line against the target heading at formationAxisTime, and
+  // how fast it is turning
+  float formationAxis;
+  float formationAxisTime;
+  float formationAxisRate;
+  bool haveFormationAxis;
+
+  // Sensor booleans
+  bool frontProxSensor;
+  bool rearProxSensor;
+  bool friendLeft;
+  bool friendRight;
+  bool friendAhead;       // raw, from the front camera's last packet
+  bool friendBehind;      // raw, from the back camera's last packet
+  bool aligned;
+
+  // What the state machine sees, rebuilt by every FuseSensors
+  SensorSnapshot sensors;
+
+  float trans_speed;
+  float rot_speed;
+  bool openServo;
+
+  float leftMotorSpeed;
+  float rightMotorSpeed;
+};
+#endif
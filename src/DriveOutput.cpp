@@ -0,0 +1,91 @@
+#include <math.h>
+
+#include "DriveOutput.h"
+
+DriveOutput::DriveOutput(){
+  SetLimits(0., 0., 0.);
+  Reset();
+};
+
+void DriveOutput::SetLimits(float maxWheelSpeed, float maxWheelAccel, float servoSlewRate){
+  this->maxWheelSpeed = maxWheelSpeed;
+  this->maxWheelAccel = maxWheelAccel;
+  this->servoSlewRate = servoSlewRate;
+};
+
+void DriveOutput::Reset(){
+  leftSpeed = 0.;
+  rightSpeed = 0.;
+  servoPosition = kServoOpenPosition;
+  lastTime = 0.;
+  haveTime = false;
+  saturatedCount = 0;
+  accelLimitedCount = 0;
+};
+
+void DriveOutput::Update(float trans, float rot, bool servoOpen, float time){
+  float left = (2.*trans + rot) / 2.;
+  float right = (2.*trans - rot) / 2.;
+
+  if(maxWheelSpeed > 0.){
+    float fastest = fabs(left) > fabs(right) ? fabs(left) : fabs(right);
+    if(fastest > maxWheelSpeed){
+      float scale = maxWheelSpeed / fastest;
+      left *= scale;
+      right *= scale;
+      saturatedCount++;
+    }
+  }
+
+  float servoTarget = servoOpen ? kServoOpenPosition : kServoClosedPosition;
+
+  bool limit = haveTime and time >= lastTime;
+  float dt = limit ? time - lastTime : 0.;
+  lastTime = time;
+  haveTime = true;
+
+  if(limit and maxWheelAccel > 0.){
+    float leftChange = left - leftSpeed;
+    float rightChange = right - rightSpeed;
+    float largest = fabs(leftChange) > fabs(rightChange) ? fabs(leftChange) : fabs(rightChange);
+    float allowed = maxWheelAccel * dt;
+    if(largest > allowed){
+      float scale = allowed / largest;
+      left = leftSpeed + scale*leftChange;
+      right = rightSpeed + scale*rightChange;
+      accelLimitedCount++;
+    }
+  }
+
+  if(limit and servoSlewRate > 0.){
+    float step = servoSlewRate * dt;
+    if(servoTarget > servoPosition + step)
+      servoTarget = servoPosition + step;
+    else if(servoTarget < servoPosition - step)
+      servoTarget = servoPosition - step;
+  }
+
+  leftSpeed = left;
+  rightSpeed = right;
+  servoPosition = servoTarget;
+};
+
+float DriveOutput::GetLeftSpeed(){
+  return leftSpeed;
+};
+
+float DriveOutput::GetRightSpeed(){
+  return rightSpeed;
+};
+
+float DriveOutput::GetServoPosition(){
+  return servoPosition;
+};
+
+long DriveOutput::GetSaturatedCount(){
+  return saturatedCount;
+};
+
+long DriveOutput::GetAccelLimitedCount(){
+  return accelLimitedCount;
+};
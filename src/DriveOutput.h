@@ -0,0 +1,68 @@
+#ifndef DRIVE_OUTPUT_H
+#define DRIVE_OUTPUT_H
+
+#include <math.h>
+
+// Output stage between the state machine and the motors. Turns the
+// translational and rotational speeds into left and right wheel speeds,
+//
+//   left = (2 trans + rot) / 2, right = (2 trans - rot) / 2,
+//
+// then limits them in two steps:
+//
+// Saturation: if either wheel would run faster than maxWheelSpeed both are
+// scaled down by the same factor, so the robot slows along the path it
+// was asked to turn on instead of straightening it out.
+//
+// Acceleration: neither wheel's speed changes by more than maxWheelAccel
+// times the time since the last update. Both wheels share one scale factor
+// for their change, so during the ramp the pair moves straight towards
+// the command and the turning ratio blends from the old one to the new.
+//
+// The servo position steps between kServoOpenPosition and
+// kServoClosedPosition, at servoSlewRate if that is set.
+//
+// A limit of 0 disables it. The first update, and any that goes back in
+// time, passes the command straight through as there is no interval to
+// limit over.
+
+const float kServoOpenPosition = 0.;       // radians
+const float kServoClosedPosition = M_PI;
+
+class DriveOutput{
+
+ public:
+
+  DriveOutput();
+
+  void SetLimits(float maxWheelSpeed, float maxWheelAccel, float servoSlewRate);
+  void Reset();
+
+  // One control tick at time seconds
+  void Update(float trans, float rot, bool servoOpen, float time);
+
+  float GetLeftSpeed();
+  float GetRightSpeed();
+  float GetServoPosition();   // radians
+
+  // Updates whose command was cut by the wheel speed or acceleration limit
+  long GetSaturatedCount();
+  long GetAccelLimitedCount();
+
+ private:
+
+  float maxWheelSpeed;    // wheel speed units
+  float maxWheelAccel;    // wheel speed units per second
+  float servoSlewRate;    // radians per second
+
+  float leftSpeed;
+  float rightSpeed;
+  float servoPosition;
+  float lastTime;
+  bool haveTime;
+
+  long saturatedCount;
+  long accelLimitedCount;
+};
+
+#endif
@@ -0,0 +1,139 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "ControllerParams.h"
+
+void DefaultControllerParams(ControllerParams& params){
+  params.alignKp = 8.0;
+  params.alignKi = 0.;
+  params.alignKd = 0.;
+  params.catchUpKp = 4.0;
+  params.catchUpKi = 0.;
+  params.catchUpKd = 0.;
+  params.impulseKp = 4.0;
+  params.impulseKi = 0.;
+  params.impulseKd = 0.;
+  params.steeringFeedForward = 0.;
+  params.steeringIntegralLimit = 1.;
+  params.slowGainScale = 1.;
+  params.cruiseSpeed = 5.;
+  params.slowSpeed = 2.5;
+  params.reverseSpeed = -2.5;
+  params.alignThreshold = 0.05;
+  params.evadeDuration = 5.;
+  params.seamMergeAngle = 0.1;
+  params.closingTime = 0.;
+  params.alignHysteresis = 0.;
+  params.alignDwell = 0.;
+  params.friendDwell = 0.1;
+  params.maxWheelSpeed = 0.;
+  params.maxWheelAccel = 50.;
+  params.servoSlewRate = 0.;
+}
+
+static PidGains MakeGains(float kp, float ki, float kd, float feedForward,
+			  const ControllerParams& params){
+  PidGains gains;
+  gains.kp = kp;
+  gains.ki = ki;
+  gains.kd = kd;
+  gains.feedForward = feedForward;
+  gains.integralLimit = params.steeringIntegralLimit;
+  // Turning on the spot, the wheels saturate at a rotation of twice their
+  // top speed
+  gains.outputLimit = 2.*params.maxWheelSpeed;
+  return gains;
+}
+
+// Align holds a fixed heading, so there is nothing to feed forward
+PidGains AlignGains(const ControllerParams& params){
+  return MakeGains(params.alignKp, params.alignKi, params.alignKd, 0., params);
+}
+
+PidGains CatchUpGains(const ControllerParams& params){
+  return MakeGains(params.catchUpKp, params.catchUpKi, params.catchUpKd,
+		   params.steeringFeedForward, params);
+}
+
+PidGains ImpulseGains(const ControllerParams& params){
+  return MakeGains(params.impulseKp, params.impulseKi, params.impulseKd,
+		   params.steeringFeedForward, params);
+}
+
+bool ParseControllerParam(const char* arg, ControllerParams& params){
+  if(strncmp(arg, "--kp=", 5) == 0){
+    params.catchUpKp = atof(arg + 5);
+    params.impulseKp = params.catchUpKp;
+  }
+  else if(strncmp(arg, "--align-kp=", 11) == 0)
+    params.alignKp = atof(arg + 11);
+  else if(strncmp(arg, "--align-ki=", 11) == 0)
+    params.alignKi = atof(arg + 11);
+  else if(strncmp(arg, "--align-kd=", 11) == 0)
+    params.alignKd = atof(arg + 11);
+  else if(strncmp(arg, "--catchup-kp=", 13) == 0)
+    params.catchUpKp = atof(arg + 13);
+  else if(strncmp(arg, "--catchup-ki=", 13) == 0)
+    params.catchUpKi = atof(arg + 13);
+  else if(strncmp(arg, "--catchup-kd=", 13) == 0)
+    params.catchUpKd = atof(arg + 13);
+  else if(strncmp(arg, "--impulse-kp=", 13) == 0)
+    params.impulseKp = atof(arg + 13);
+  else if(strncmp(arg, "--impulse-ki=", 13) == 0)
+    params.impulseKi = atof(arg + 13);
+  else if(strncmp(arg, "--impulse-kd=", 13) == 0)
+    params.impulseKd = atof(arg + 13);
+  else if(strncmp(arg, "--feed-forward=", 15) == 0)
+    params.steeringFeedForward = atof(arg + 15);
+  else if(strncmp(arg, "--integral-limit=", 17) == 0)
+    params.steeringIntegralLimit = atof(arg + 17);
+  else if(strncmp(arg, "--slow-gain-scale=", 18) == 0)
+    params.slowGainScale = atof(arg + 18);
+  else if(strncmp(arg, "--cruise-speed=", 15) == 0)
+    params.cruiseSpeed = atof(arg + 15);
+  else if(strncmp(arg, "--slow-speed=", 13) == 0)
+    params.slowSpeed = atof(arg + 13);
+  else if(strncmp(arg, "--reverse-speed=", 16) == 0)
+    params.reverseSpeed = atof(arg + 16);
+  else if(strncmp(arg, "--align-threshold=", 18) == 0)
+    params.alignThreshold = atof(arg + 18);
+  else if(strncmp(arg, "--evade-duration=", 17) == 0)
+    params.evadeDuration = atof(arg + 17);
+  else if(strncmp(arg, "--seam-merge-angle=", 19) == 0)
+    params.seamMergeAngle = atof(arg + 19);
+  else if(strncmp(arg, "--closing-time=", 15) == 0)
+    params.closingTime = atof(arg + 15);
+  else if(strncmp(arg, "--align-hysteresis=", 19) == 0)
+    params.alignHysteresis = atof(arg + 19);
+  else if(strncmp(arg, "--align-dwell=", 14) == 0)
+    params.alignDwell = atof(arg + 14);
+  else if(strncmp(arg, "--friend-dwell=", 15) == 0)
+    params.friendDwell = atof(arg + 15);
+  else if(strncmp(arg, "--max-wheel-speed=", 18) == 0)
+    params.maxWheelSpeed = atof(arg + 18);
+  else if(strncmp(arg, "--max-wheel-accel=", 18) == 0)
+    params.maxWheelAccel = atof(arg + 18);
+  else if(strncmp(arg, "--servo-slew-rate=", 18) == 0)
+    params.servoSlewRate = atof(arg + 18);
+  else
+    return false;
+  return true;
+}
+
+void PrintControllerParams(const ControllerParams& params){
+  printf("align pid=%.3f/%.3f/%.3f catchup pid=%.3f/%.3f/%.3f impulse pid=%.3f/%.3f/%.3f"
+	 " feed-forward=%.3f integral-limit=%.3f slow-gain-scale=%.3f"
+	 " cruise=%.3f slow=%.3f reverse=%.3f align=%.4f evade=%.2f seam=%.3f closing=%.2f"
+	 " hysteresis=%.3f align-dwell=%.2f friend-dwell=%.2f"
+	 " max-wheel-speed=%.2f max-wheel-accel=%.1f servo-slew=%.2f\n",
+	 params.alignKp, params.alignKi, params.alignKd,
+	 params.catchUpKp, params.catchUpKi, params.catchUpKd,
+	 params.impulseKp, params.impulseKi, params.impulseKd,
+	 params.steeringFeedForward, params.steeringIntegralLimit, params.slowGainScale,
+	 params.cruiseSpeed, params.slowSpeed, params.reverseSpeed,
+	 params.alignThreshold, params.evadeDuration, params.seamMergeAngle,
+	 params.closingTime, params.alignHysteresis, params.alignDwell,
+	 params.friendDwell, params.maxWheelSpeed, params.maxWheelAccel,
+	 params.servoSlewRate);
+}
@@ -0,0 +1,71 @@
+#ifndef CONTROLLER_PARAMS_H
+#define CONTROLLER_PARAMS_H
+
+#include "PidController.h"
+
+// Tunable gains and speed levels of the formation controller. The defaults
+// are the values the controller was originally written with, apart from
+// those added since, which were tuned in the headless simulator.
+//
+// Each steering state has its own PID gains, see PidController.h. Align
+// turns on the spot on the magnetic heading error with the heading rate
+// as the measured rate; CatchUp and ImpulseSpeed steer on the formation
+// heading error and are scheduled by their speed with slowGainScale.
+struct ControllerParams{
+  float alignKp;          // Align, turning on the spot
+  float alignKi;
+  float alignKd;
+  float catchUpKp;        // CatchUp
+  float catchUpKi;
+  float catchUpKd;
+  float impulseKp;        // ImpulseSpeed
+  float impulseKi;
+  float impulseKd;
+  float steeringFeedForward;  // rotation per rad/s the formation line turns
+                              // at, for CatchUp and ImpulseSpeed
+  float steeringIntegralLimit; // bound on the integral terms, rotation units
+  float slowGainScale;    // moving state gains at slowSpeed relative to
+                          // cruiseSpeed
+  float cruiseSpeed;      // SetTransSpeed(1)
+  float slowSpeed;        // SetTransSpeed(2)
+  float reverseSpeed;     // SetTransSpeed(-1)
+  float alignThreshold;   // radians of heading error still counted as aligned
+  float evadeDuration;    // seconds StateEvade backs away for
+  float seamMergeAngle;   // radians within which blobs from neighbouring
+                          // omni segments are taken to be the same robot
+  float closingTime;      // seconds to contact with the team mate ahead
+                          // that raises closingFast, 0 disables it. Off by
+                          // default: the range table in BlobTracker.cpp is
+                          // only calibrated for the headless simulator
+  float alignHysteresis;  // radians past alignThreshold before an aligned
+                          // robot counts as misaligned again
+  float alignDwell;       // seconds aligned must hold before the FSM sees
+                          // it change, either way
+  float friendDwell;      // the same for friendLeft/Right/Ahead/Behind
+  float maxWheelSpeed;    // wheel speed the output stage saturates at,
+                          // 0 for none, see DriveOutput.h
+  float maxWheelAccel;    // wheel speed change per second, 0 for none
+  float servoSlewRate;    // radians per second, 0 steps the servo
+};
+
+void DefaultControllerParams(ControllerParams& params);
+
+// Gain sets of the steering states
+PidGains AlignGains(const ControllerParams& params);
+PidGains CatchUpGains(const ControllerParams& params);
+PidGains ImpulseGains(const ControllerParams& params);
+
+// Parses one --align-kp=, --align-ki=, --align-kd=, --catchup-kp=,
+// --catchup-ki=, --catchup-kd=, --impulse-kp=, --impulse-ki=,
+// --impulse-kd=, --feed-forward=, --integral-limit=, --slow-gain-scale=,
+// --cruise-speed=, --slow-speed=, --reverse-speed=, --align-threshold=,
+// --evade-duration=, --seam-merge-angle=, --closing-time=,
+// --align-hysteresis=, --align-dwell=, --friend-dwell=, --max-wheel-speed=,
+// --max-wheel-accel= or --servo-slew-rate= flag. --kp= sets
+// the proportional gain of both CatchUp and ImpulseSpeed.
+// Returns false if the argument is not a controller parameter.
+bool ParseControllerParam(const char* arg, ControllerParams& params);
+
+void PrintControllerParams(const ControllerParams& params);
+
+#endif
@@ -4,44 +4,77 @@
 
 #include "FSM.h"
 #include "State.h"
+#include "StateImpulseSpeed.h"
+#include "StateCruise.h"
+#include "StateCatchUp.h"
 #include "StateAlign.h"
+#include "StateEvade.h"
+#include "StateHalt.h"
 #include "blobClass.h"
 
+// Optional timeline tracing (BOT_TRACING builds)
+#include "../Trace.h"
+
 using namespace std;
 
 StateManager::StateManager(){
+  ControllerParams defaults;
+  DefaultControllerParams(defaults);
+  Init(defaults);
+};
+
+StateManager::StateManager(const ControllerParams& params){
+  Init(params);
+};
+
+void StateManager::Init(const ControllerParams& params){
 
-  //currentState = new StateRandomWalk();
-  //currentState = new StateCatchUp();
-  currentState = new StateAlign();
+  states[STATE_ALIGN] = new StateAlign();
+  states[STATE_CRUISE] = new StateCruise();
+  states[STATE_CATCH_UP] = new StateCatchUp();
+  states[STATE_HALT] = new StateHalt();
+  states[STATE_IMPULSE_SPEED] = new StateImpulseSpeed();
+  states[STATE_EVADE] = new StateEvade();
 
-  trans_speed = 5.;
+  currentState = states[STATE_ALIGN];
+  currentState->Enter();
+
+  this->params = params;
+
+  trans_speed = params.cruiseSpeed;
   rot_speed = 0.;
   openServo = true;
-  
-  kp = 4.0;
 
-  magneticHeadingError = 0.;
-  formationHeadingError = 0.;    
+  transitionCount = 0;
+};
+
+StateManager::~StateManager(){
+  for(int i = 0; i < STATE_COUNT; i++)
+    delete states[i];
 };
 
-void StateManager::UpdateBehaviour(bool* stimuli){
+void StateManager::UpdateBehaviour(const SensorSnapshot& sensors){
   State * newState;
   
-  newState = currentState->Transition(stimuli);
+  newState = currentState->Transition(this, sensors);
   
   // Transition returns NULL if no transition occurs
   // (i.e when state remains the same);
   if(newState != NULL){
-    delete currentState;
+    TRACE_STATE_CHANGE(currentState->GetNameString().c_str(),
+		       newState->GetNameString().c_str());
+    currentState->Exit();
     currentState = newState;
+    currentState->Enter();
+    transitionCount++;
   }
   
 };
 
-void StateManager::ExecuteBehaviour(float& trans, float& rot, bool& servoOpen){
+void StateManager::ExecuteBehaviour(const SensorSnapshot& sensors, float& trans, float& rot,
+				    bool& servoOpen){
   
-  currentState->Execute(this);
+  currentState->Execute(this, sensors);
   
   trans = trans_speed;
   rot = rot_speed;
@@ -56,24 +89,36 @@ string StateManager::GetCurrentStateName(){
   return currentState->GetNameString();
 }
 
-void StateManager::SetMagneticHeadingError(float value){
-  magneticHeadingError = value;
+long StateManager::GetTransitionCount(){
+  return transitionCount;
 };
 
-void StateManager::SetFormationHeadingError(float value){
-  formationHeadingError = value;
+bool StateManager::SetCurrentState(const string& name){
+  for(int i = 0; i < STATE_COUNT; i++){
+    if(states[i]->GetNameString() == name){
+      currentState = states[i];
+      currentState->Enter();
+      return true;
+    }
+  }
+  return false;
 };
 
-float StateManager::GetMagneticHeadingError(){
-  return magneticHeadingError;
+State * StateManager::GetState(int state){
+  return states[state];
 };
 
-float StateManager::GetFormationHeadingError(){
-  return formationHeadingError;
+float StateManager::GetSteeringGainScale(){
+  return SpeedGainScale(trans_speed, params.cruiseSpeed, params.slowSpeed,
+			params.slowGainScale);
 };
 
-float StateManager::GetProportionalGain(){
-  return kp;
+void StateManager::SetParams(const ControllerParams& value){
+  params = value;
+};
+
+const ControllerParams& StateManager::GetParams(){
+  return params;
 };
 
 void StateManager::SetRotSpeed(float speed){
@@ -82,13 +127,13 @@ void StateManager::SetRotSpeed(float speed){
 
 void StateManager::SetTransSpeed(int speed){
   if(speed == 1){
-    trans_speed = 5.;
+    trans_speed = params.cruiseSpeed;
   }
   else if(speed == -1){
-    trans_speed = -2.5;
+    trans_speed = params.reverseSpeed;
   }
   else if(speed == 2){
-    trans_speed = 2.5;
+    trans_speed = params.slowSpeed;
   }
   else{
     trans_speed = 0.;
@@ -101,14 +146,6 @@ bool StateManager::MovingForward(){
     return false;
 };
 
-void StateManager::UpdateBlobData(vector<blobClass*> aVectorOfBlobs){
-  
-  for(int i = 0; i < aVectorOfBlobs.size(); i++){
-    blobVector.push_back(aVectorOfBlobs[i]);
-  }
-
-};
-
 void StateManager::CloseServo(){
   openServo = false;
 };
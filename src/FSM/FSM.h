@@ -9,31 +9,58 @@
 
 // Abstract base class for state
 #include "State.h"
+#include "SensorSnapshot.h"
 #include "blobClass.h"
+#include "ControllerParams.h"
 
 using namespace std;
 
+// The formation states, see StateManager::GetState
+enum FormationState{
+  STATE_ALIGN = 0,
+  STATE_CRUISE,
+  STATE_CATCH_UP,
+  STATE_HALT,
+  STATE_IMPULSE_SPEED,
+  STATE_EVADE,
+  STATE_COUNT
+};
+
 class StateManager{
 
 public:
 
   StateManager();
-
-  void UpdateBehaviour(bool* stimuli);
-  void UpdateBlobData(vector<blobClass*> aVectorOfBlobs);
-
-  void ExecuteBehaviour(float& trans, float& rot, bool& servoOpen);
+  StateManager(const ControllerParams& params);
+  ~StateManager();
+
+  // Both take the tick's snapshot by reference and keep nothing of it, so
+  // the same snapshot is normally passed to one and then the other.
+  void UpdateBehaviour(const SensorSnapshot& sensors);
+  void ExecuteBehaviour(const SensorSnapshot& sensors, float& trans, float& rot,
+			bool& servoOpen);
  
   void PrintCurrentState();
   string GetCurrentStateName();
 
-  float GetProportionalGain();
+  // State changes made by UpdateBehaviour so far
+  long GetTransitionCount();
 
-  void SetMagneticHeadingError(float value);
-  void SetFormationHeadingError(float value);
+  // Enters the named state, for tools that need to start from a given
+  // state. False if the name is not a formation state.
+  bool SetCurrentState(const string& name);
 
-  float GetMagneticHeadingError();
-  float GetFormationHeadingError();
+  // The manager's instance of a state. Every state is made once, up front,
+  // so a transition costs an Enter() rather than a new and delete in the
+  // control loop.
+  State * GetState(int state);
+
+  // Gain multiplier for the translational speed last set, see
+  // SpeedGainScale
+  float GetSteeringGainScale();
+
+  void SetParams(const ControllerParams& value);
+  const ControllerParams& GetParams();
 
   void SetRotSpeed(float speed);
   void SetTransSpeed(int speed);
@@ -44,18 +71,18 @@ public:
   bool MovingForward();
 
 private:
+
+  void Init(const ControllerParams& params);
   
+  State * states[STATE_COUNT];
   State * currentState;
 
   float trans_speed;
   float rot_speed;
   bool openServo;
 
-  float magneticHeadingError;
-  float formationHeadingError;
-
-  float kp;
+  long transitionCount;
 
-  vector<blobClass*> blobVector;
+  ControllerParams params;
 };
 #endif
@@ -0,0 +1,75 @@
+#include <math.h>
+
+#include "PidController.h"
+
+PidController::PidController(){
+  PidGains none = {0., 0., 0., 0., 0., 0.};
+  SetGains(none);
+  Reset();
+};
+
+PidController::PidController(const PidGains& gains){
+  SetGains(gains);
+  Reset();
+};
+
+void PidController::SetGains(const PidGains& gains){
+  this->gains = gains;
+};
+
+void PidController::Reset(){
+  integral = 0.;
+  lastTime = 0.;
+  haveTime = false;
+};
+
+float PidController::Update(float error, float measurementRate, float drift, float time,
+			    float scale){
+  float dt = haveTime ? time - lastTime : 0.;
+  lastTime = time;
+  haveTime = true;
+
+  float kp = scale * gains.kp;
+  float ki = scale * gains.ki;
+  float kd = scale * gains.kd;
+
+  float output = kp*error + kd*measurementRate + gains.feedForward*drift;
+
+  if(ki > 0.){
+    // Conditional integration: hold the integral while the output is
+    // saturated in the direction it would push it further
+    bool saturated = gains.outputLimit > 0. and
+      fabs(output + ki*integral) >= gains.outputLimit and
+      (output + ki*integral) * error > 0.;
+    if(dt > 0. and not saturated)
+      integral += error * dt;
+
+    float limit = gains.integralLimit / ki;
+    if(integral > limit)
+      integral = limit;
+    else if(integral < -limit)
+      integral = -limit;
+
+    output += ki*integral;
+  }
+
+  if(gains.outputLimit > 0.){
+    if(output > gains.outputLimit)
+      output = gains.outputLimit;
+    else if(output < -gains.outputLimit)
+      output = -gains.outputLimit;
+  }
+
+  return output;
+};
+
+float PidController::GetIntegral(){
+  return integral;
+};
+
+float SpeedGainScale(float speed, float cruiseSpeed, float slowSpeed, float slowScale){
+  if(cruiseSpeed == slowSpeed)
+    return 1.;
+  float scale = 1. + (slowScale - 1.) * (cruiseSpeed - fabs(speed)) / (cruiseSpeed - slowSpeed);
+  return scale > 0. ? scale : 0.;
+}
@@ -0,0 +1,57 @@
+#ifndef PID_CONTROLLER_H
+#define PID_CONTROLLER_H
+
+// Steering controller shared by the states that turn the robot.
+//
+//   output = scale * (kp e + ki integral(e) + kd dy/dt) + feedForward drift
+//
+// The error e is measurement less reference, so a positive error asks for
+// a positive (clockwise) output. The derivative is taken on the measured
+// rate rather than the error, so a jump in the reference, such as a new
+// team mate coming into view, does not kick the output. drift is the rate
+// the error would change at by itself with the output held at zero, e.g.
+// the formation line turning; feedForward is the output that cancels a
+// drift of 1 rad/s.
+//
+// The integral is clamped so ki * integral stays within integralLimit, and
+// stops growing while the output it is adding to is at outputLimit. scale
+// schedules kp, ki and kd together, see SpeedGainScale.
+struct PidGains{
+  float kp;
+  float ki;               // per second
+  float kd;               // seconds
+  float feedForward;      // output per rad/s of drift
+  float integralLimit;    // output units
+  float outputLimit;      // output units, 0 for none
+};
+
+class PidController{
+
+ public:
+
+  PidController();
+  PidController(const PidGains& gains);
+
+  void SetGains(const PidGains& gains);
+  void Reset();
+
+  // One step at time seconds. A step with no time since the last leaves
+  // the integral alone.
+  float Update(float error, float measurementRate, float drift, float time,
+	       float scale);
+
+  float GetIntegral();
+
+ private:
+
+  PidGains gains;
+  float integral;
+  float lastTime;
+  bool haveTime;
+};
+
+// Gain multiplier for a state moving at speed: 1 at cruiseSpeed, slowScale
+// at slowSpeed, linear in between and beyond, never below zero.
+float SpeedGainScale(float speed, float cruiseSpeed, float slowSpeed, float slowScale);
+
+#endif
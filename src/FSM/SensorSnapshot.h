@@ -0,0 +1,97 @@
+#ifndef SENSOR_SNAPSHOT_H
+#define SENSOR_SNAPSHOT_H
+
+#include <cstddef>
+#include <stdint.h>
+#include <vector>
+
+#include "blobClass.h"
+
+using namespace std;
+
+// The formation stimuli, in the order BotController latches them and the
+// bit order of a Stimuli mask
+enum StimulusBit{
+  STIMULUS_FRONT_PROX = 0,
+  STIMULUS_REAR_PROX,
+  STIMULUS_FRIEND_LEFT,
+  STIMULUS_FRIEND_RIGHT,
+  STIMULUS_FRIEND_AHEAD,
+  STIMULUS_FRIEND_BEHIND,
+  STIMULUS_ALIGNED,
+  STIMULUS_CLOSING_FAST,    // a team mate ahead will be reached soon
+  STIMULUS_COUNT
+};
+
+const int kNumStimuli = STIMULUS_COUNT;
+
+// One bit per stimulus. A whole set is a byte, so it copies for nothing,
+// compares in one go and indexes a 1 << kNumStimuli table directly.
+class Stimuli{
+
+ public:
+
+  Stimuli(){ mask = 0; };
+  explicit Stimuli(uint8_t value){ mask = value; };
+
+  bool Get(int bit) const { return (mask >> bit) & 1; };
+  void Set(int bit, bool value){
+    if(value)
+      mask |= 1 << bit;
+    else
+      mask &= ~(1 << bit);
+  };
+
+  uint8_t GetMask() const { return mask; };
+
+  bool FrontProx() const { return Get(STIMULUS_FRONT_PROX); };
+  bool RearProx() const { return Get(STIMULUS_REAR_PROX); };
+  bool FriendLeft() const { return Get(STIMULUS_FRIEND_LEFT); };
+  bool FriendRight() const { return Get(STIMULUS_FRIEND_RIGHT); };
+  bool FriendAhead() const { return Get(STIMULUS_FRIEND_AHEAD); };
+  bool FriendBehind() const { return Get(STIMULUS_FRIEND_BEHIND); };
+  bool Aligned() const { return Get(STIMULUS_ALIGNED); };
+  bool ClosingFast() const { return Get(STIMULUS_CLOSING_FAST); };
+
+ private:
+
+  uint8_t mask;
+};
+
+// Everything the state machine reads about the world in one tick. The
+// controller fills it once, after fusing the sensors, and hands the same
+// snapshot to StateManager::UpdateBehaviour and ExecuteBehaviour by const
+// reference.
+struct SensorSnapshot{
+
+  SensorSnapshot(){
+    magneticHeadingError = 0.;
+    formationHeadingError = 0.;
+    headingRate = 0.;
+    formationRate = 0.;
+    blobs = NULL;
+    time = 0.;
+    headingTime = 0.;
+    omniTime = 0.;
+  };
+
+  Stimuli stimuli;
+
+  float magneticHeadingError;    // radians, body against the target heading
+  float formationHeadingError;   // radians, steering error along the formation
+  float headingRate;             // radians per second, of magneticHeadingError
+  float formationRate;           // radians per second the formation line
+                                 // turns at against the target heading
+
+  // Fused omni view in bearing order, owned by the controller and only
+  // valid for the tick. NULL if there is none.
+  const vector<blobClass*>* blobs;
+
+  // Simulation time in seconds of the tick, and of the orientation reading
+  // and the latest omni packet it was built from
+  float time;
+  float headingTime;
+  float omniTime;
+};
+
+#endif
@@ -6,6 +6,7 @@
 #include <string>
 
 //#include "FSM.h"
+#include "SensorSnapshot.h"
 
 class StateManager;
 
@@ -16,16 +17,20 @@ class State{
  public:
 
   State(){};
-  ~State(){};
+  virtual ~State(){};
 
+  // Called each time the state is entered. The state manager keeps one
+  // instance of every state for the whole run, so this is where anything
+  // left over from the last visit is cleared.
   virtual void Enter(){};
   
-  virtual void Execute(StateManager* fsm ){};
+  virtual void Execute(StateManager* fsm, const SensorSnapshot& sensors){};
   
   virtual void Execute(){};
   virtual void Exit(){};
   
-  virtual State * Transition(bool* stimuli){};
+  // The state to change to, one of fsm's, or NULL to stay
+  virtual State * Transition(StateManager* fsm, const SensorSnapshot& sensors){};
 
   virtual void Print(){};
 
@@ -33,27 +38,9 @@ class State{
 
   virtual string GetNameString(){};
   
-  void SetStimuli(bool * stimuli){
-    frontProx = stimuli[0];
-    rearProx = stimuli[1];
-    friendLeft = stimuli[2];
-    friendRight = stimuli[3];
-    friendAhead = stimuli[4];
-    friendBehind = stimuli[5];
-    aligned = stimuli[6];
-  };
-
  protected:
 
   string name;
-  
-  bool frontProx;
-  bool rearProx;
-  bool friendLeft;
-  bool friendRight;
-  bool friendAhead;
-  bool friendBehind;
-  bool aligned;
 
 };
 #endif
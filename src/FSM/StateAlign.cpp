@@ -20,44 +20,47 @@ name = "Align";
  srand (time(NULL));
 };
 
-void StateAlign::Enter(){};
+void StateAlign::Enter(){
+  steering.Reset();
+};
 
-void StateAlign::Execute(StateManager * fsm){
+void StateAlign::Execute(StateManager * fsm, const SensorSnapshot& sensors){
   //printf("Executing behaviour %s...\n", name.c_str());
 
   fsm->SetTransSpeed(0);
   
-  // This value should depend on magneticHeadingError
-  float trackingError = fsm->GetMagneticHeadingError();
-  float kp = fsm->GetProportionalGain();  
-  
-  fsm->SetRotSpeed(kp*trackingError);
+  // Turn on the spot the short way round. The heading rate is the
+  // measured rate for the derivative term, damping a robot that carries
+  // its turn past the target.
+  steering.SetGains(AlignGains(fsm->GetParams()));
+  fsm->SetRotSpeed(steering.Update(sensors.magneticHeadingError, sensors.headingRate,
+				   0., sensors.time, 1.));
 
 };
 
 void StateAlign::Exit(){};
 
-State * StateAlign::Transition(bool* stimuli){
+State * StateAlign::Transition(StateManager * fsm, const SensorSnapshot& sensors){
 
-  SetStimuli(stimuli);
+  Stimuli stimuli = sensors.stimuli;
 
-  if( frontProx ){
-    return new StateEvade();
+  if( stimuli.FrontProx() ){
+    return fsm->GetState(STATE_EVADE);
   }
-  else if( not aligned){
+  else if( not stimuli.Aligned()){
     return NULL;
   }
-  else if(not (friendAhead and friendBehind) ){
-    return new StateCruise();
+  else if(not (stimuli.FriendAhead() and stimuli.FriendBehind()) ){
+    return fsm->GetState(STATE_CRUISE);
   }
-  else if(friendBehind and not friendAhead){
-    return new StateHalt();
+  else if(stimuli.FriendBehind() and not stimuli.FriendAhead()){
+    return fsm->GetState(STATE_HALT);
   }
-  else if(friendAhead and friendBehind){
-    return new StateImpulseSpeed();
+  else if(stimuli.FriendAhead() and stimuli.FriendBehind()){
+    return fsm->GetState(STATE_IMPULSE_SPEED);
   }
-   else if(friendAhead and not friendBehind){
-    return new StateCatchUp();
+   else if(stimuli.FriendAhead() and not stimuli.FriendBehind()){
+    return fsm->GetState(STATE_CATCH_UP);
   }
   else{
     return NULL;
@@ -6,6 +6,7 @@
 #include <string>
 
 #include "State.h"
+#include "PidController.h"
 
 class StateAlign: public State{
 
@@ -14,10 +15,10 @@ class StateAlign: public State{
   StateAlign();
 
   void Enter();
-  void Execute(StateManager * fsm);
+  void Execute(StateManager * fsm, const SensorSnapshot& sensors);
   void Exit();
   
-  State * Transition(bool* stimuli);
+  State * Transition(StateManager * fsm, const SensorSnapshot& sensors);
 
   void Print();
   
@@ -26,6 +27,7 @@ class StateAlign: public State{
   private:
 
   string name;
+  PidController steering;
 
 };
 #endif
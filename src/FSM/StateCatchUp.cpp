@@ -20,42 +20,48 @@ StateCatchUp::StateCatchUp(){
   srand (time(NULL));
 };
 
-void StateCatchUp::Enter(){};
+void StateCatchUp::Enter(){
+  steering.Reset();
+};
 
-void StateCatchUp::Execute(StateManager * fsm){
+void StateCatchUp::Execute(StateManager * fsm, const SensorSnapshot& sensors){
   //printf("Executing behaviour %s...\n", name.c_str());
 
   // This speed is half the standard speed 
-  fsm->SetTransSpeed(1);
-  
-  // This value should depend on formationHeadingError
-  float trackingError = fsm->GetFormationHeadingError();
-  float kp = fsm->GetProportionalGain();  
+  if(sensors.stimuli.ClosingFast())
+    fsm->SetTransSpeed(2);
+  else
+    fsm->SetTransSpeed(1);
   
-  fsm->SetRotSpeed(kp*trackingError);
+  // Steer along the formation line, feeding forward how fast the line
+  // itself turns, with the gains scheduled by the speed just set
+  steering.SetGains(CatchUpGains(fsm->GetParams()));
+  fsm->SetRotSpeed(steering.Update(sensors.formationHeadingError, sensors.headingRate,
+				   sensors.formationRate, sensors.time,
+				   fsm->GetSteeringGainScale()));
 
 };
 
 void StateCatchUp::Exit(){};
 
-State * StateCatchUp::Transition(bool* stimuli){
+State * StateCatchUp::Transition(StateManager * fsm, const SensorSnapshot& sensors){
 
-  SetStimuli(stimuli);
+  Stimuli stimuli = sensors.stimuli;
 
-  if( frontProx ){
-    return new StateEvade();
+  if( stimuli.FrontProx() ){
+    return fsm->GetState(STATE_EVADE);
   }
-  else if(friendAhead and not friendBehind){
+  else if(stimuli.FriendAhead() and not stimuli.FriendBehind()){
     return NULL;
   }
-  else if(friendAhead and friendBehind){
-    return new StateImpulseSpeed();
+  else if(stimuli.FriendAhead() and stimuli.FriendBehind()){
+    return fsm->GetState(STATE_IMPULSE_SPEED);
   }
-  else if(not friendBehind and not friendAhead ){
-    return new StateCruise();
+  else if(not stimuli.FriendBehind() and not stimuli.FriendAhead() ){
+    return fsm->GetState(STATE_CRUISE);
   }
-  else if(not friendAhead and friendBehind){
-    return new StateHalt();
+  else if(not stimuli.FriendAhead() and stimuli.FriendBehind()){
+    return fsm->GetState(STATE_HALT);
   }
   else{
     return NULL;
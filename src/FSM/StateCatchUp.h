@@ -6,6 +6,7 @@
 #include <string>
 
 #include "State.h"
+#include "PidController.h"
 
 
 class StateCatchUp: public State{
@@ -15,10 +16,10 @@ class StateCatchUp: public State{
   StateCatchUp();
 
   void Enter();
-  void Execute(StateManager * fsm);
+  void Execute(StateManager * fsm, const SensorSnapshot& sensors);
   void Exit();
   
-  State * Transition(bool* stimuli);
+  State * Transition(StateManager * fsm, const SensorSnapshot& sensors);
 
   void Print();
   
@@ -27,6 +28,7 @@ class StateCatchUp: public State{
  private:
 
   std::string name;
+  PidController steering;
 
 };
 #endif
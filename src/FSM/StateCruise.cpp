@@ -22,11 +22,14 @@ StateCruise::StateCruise(){
 
 void StateCruise::Enter(){};
 
-void StateCruise::Execute(StateManager * fsm){
+void StateCruise::Execute(StateManager * fsm, const SensorSnapshot& sensors){
   //printf("Executing behaviour %s...\n", name.c_str());
 
-  // Full speed ahead!
-  fsm->SetTransSpeed(1);
+  // Full speed ahead, unless about to run into the team mate in front
+  if(sensors.stimuli.ClosingFast())
+    fsm->SetTransSpeed(2);
+  else
+    fsm->SetTransSpeed(1);
   
   // This value should depend on formationHeadingError
   fsm->SetRotSpeed(0.);
@@ -35,24 +38,24 @@ void StateCruise::Execute(StateManager * fsm){
 
 void StateCruise::Exit(){};
 
-State * StateCruise::Transition(bool* stimuli){
+State * StateCruise::Transition(StateManager * fsm, const SensorSnapshot& sensors){
 
-  SetStimuli(stimuli);
+  Stimuli stimuli = sensors.stimuli;
 
-  if(frontProx){
-    return new StateEvade();
+  if(stimuli.FrontProx()){
+    return fsm->GetState(STATE_EVADE);
   }
-  else if(friendBehind and not friendAhead){
-    return new StateHalt();
+  else if(stimuli.FriendBehind() and not stimuli.FriendAhead()){
+    return fsm->GetState(STATE_HALT);
   }
-  else if(friendAhead and not friendBehind){
-    return new StateCatchUp();
+  else if(stimuli.FriendAhead() and not stimuli.FriendBehind()){
+    return fsm->GetState(STATE_CATCH_UP);
   }
-  else if(friendAhead and friendBehind){
-    return new StateImpulseSpeed();
+  else if(stimuli.FriendAhead() and stimuli.FriendBehind()){
+    return fsm->GetState(STATE_IMPULSE_SPEED);
   }
-  else if(not aligned){
-    return new StateAlign();
+  else if(not stimuli.Aligned()){
+    return fsm->GetState(STATE_ALIGN);
   }
   else{
     return NULL;
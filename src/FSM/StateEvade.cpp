@@ -20,17 +20,21 @@ StateEvade::StateEvade(){
   /* initialize random seed: */
   srand (time(NULL));
 
-  deltaT = 5.;
+  Enter();
+};
+
+// Each visit is a new maneuver
+void StateEvade::Enter(){
+  // Set from the controller parameters when the maneuver starts
+  deltaT = 0.;
 
-  time(&timeStamp);
+  timeStamp = 0.;
   timerExpired = false;
 
   first = true;
 };
 
-void StateEvade::Enter(){};
-
-void StateEvade::Execute(StateManager * fsm){
+void StateEvade::Execute(StateManager * fsm, const SensorSnapshot& sensors){
   //printf("Executing behaviour %s...\n", name.c_str());
 
   // This speed is half the standard speed 
@@ -39,28 +43,26 @@ void StateEvade::Execute(StateManager * fsm){
   if(first){
     float r = (M_PI/2.)*float(rand()/RAND_MAX);
     fsm->SetRotSpeed(r);
+    timeStamp = sensors.time;
+    deltaT = fsm->GetParams().evadeDuration;
     first = false;
   }
+
+  // Check if manvouver has finished yet. This uses simulation time so the
+  // maneuver lasts as long however fast the simulator runs.
+  if(sensors.time - timeStamp > deltaT){
+    timerExpired = true;
+  }
 };
 
 void StateEvade::Exit(){};
 
-State * StateEvade::Transition(bool* stimuli){
-
-  SetStimuli(stimuli);
-   
-  time_t currentTime;
-  time(&currentTime);
-
-  // Check if manvouver has finished yet
-  if(difftime(currentTime, timeStamp) > deltaT){
-    timerExpired = true;
-  }
+State * StateEvade::Transition(StateManager * fsm, const SensorSnapshot& sensors){
 
   if(not timerExpired)
     return NULL;
   else
-    return  new StateAlign();
+    return  fsm->GetState(STATE_ALIGN);
 
 };
 
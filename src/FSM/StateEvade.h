@@ -14,10 +14,10 @@ class StateEvade: public State{
   StateEvade();
 
   void Enter();
-  void Execute(StateManager * fsm);
+  void Execute(StateManager * fsm, const SensorSnapshot& sensors);
   void Exit();
   
-  State * Transition(bool* stimuli);
+  State * Transition(StateManager * fsm, const SensorSnapshot& sensors);
 
   void Print();
   
@@ -28,7 +28,7 @@ class StateEvade: public State{
   string name;
 
   float deltaT;
-  time_t timeStamp;
+  float timeStamp;
   bool timerExpired;
 
   bool first;
@@ -22,7 +22,7 @@ name = "Halt";
 
 void StateHalt::Enter(){};
 
-void StateHalt::Execute(StateManager * fsm){
+void StateHalt::Execute(StateManager * fsm, const SensorSnapshot& sensors){
   //printf("Executing behaviour %s...\n", name.c_str());
   
   fsm->SetTransSpeed(0);
@@ -32,16 +32,16 @@ void StateHalt::Execute(StateManager * fsm){
 
 void StateHalt::Exit(){};
 
-State * StateHalt::Transition(bool* stimuli){
+State * StateHalt::Transition(StateManager * fsm, const SensorSnapshot& sensors){
 
-  SetStimuli(stimuli);
+  Stimuli stimuli = sensors.stimuli;
 
-  if(not aligned)
-    return new StateAlign();
-  else if(not friendBehind and not friendAhead)
-    return new StateCruise();
-  else if(friendAhead and friendBehind)
-    return new StateImpulseSpeed();
+  if(not stimuli.Aligned())
+    return fsm->GetState(STATE_ALIGN);
+  else if(not stimuli.FriendBehind() and not stimuli.FriendAhead())
+    return fsm->GetState(STATE_CRUISE);
+  else if(stimuli.FriendAhead() and stimuli.FriendBehind())
+    return fsm->GetState(STATE_IMPULSE_SPEED);
   else
       return NULL; 
 };
@@ -14,10 +14,10 @@ class StateHalt: public State{
   StateHalt();
 
   void Enter();
-  void Execute(StateManager * fsm);
+  void Execute(StateManager * fsm, const SensorSnapshot& sensors);
   void Exit();
   
-  State * Transition(bool* stimuli);
+  State * Transition(StateManager * fsm, const SensorSnapshot& sensors);
 
   void Print();
   
@@ -20,39 +20,42 @@ StateImpulseSpeed::StateImpulseSpeed(){
   srand (time(NULL));
 };
 
-void StateImpulseSpeed::Enter(){};
+void StateImpulseSpeed::Enter(){
+  steering.Reset();
+};
 
-void StateImpulseSpeed::Execute(StateManager * fsm){
+void StateImpulseSpeed::Execute(StateManager * fsm, const SensorSnapshot& sensors){
   //printf("Executing behaviour %s...\n", name.c_str());
 
   // This speed is half the standard speed 
   fsm->SetTransSpeed(2);
   
-  // This value should depend on formationHeadingError
-  float trackingError = fsm->GetFormationHeadingError();
-  float kp = fsm->GetProportionalGain();  
-  
-  fsm->SetRotSpeed(kp*trackingError);
+  // Steer along the formation line, feeding forward how fast the line
+  // itself turns, with the gains scheduled by the speed just set
+  steering.SetGains(ImpulseGains(fsm->GetParams()));
+  fsm->SetRotSpeed(steering.Update(sensors.formationHeadingError, sensors.headingRate,
+				   sensors.formationRate, sensors.time,
+				   fsm->GetSteeringGainScale()));
 
 };
 
 void StateImpulseSpeed::Exit(){};
 
-State * StateImpulseSpeed::Transition(bool* stimuli){
+State * StateImpulseSpeed::Transition(StateManager * fsm, const SensorSnapshot& sensors){
 
-  SetStimuli(stimuli);
+  Stimuli stimuli = sensors.stimuli;
 
-  if( frontProx ){
-    return new StateEvade();
+  if( stimuli.FrontProx() ){
+    return fsm->GetState(STATE_EVADE);
   }
-  else if(not friendBehind ){
-    return new StateCruise();
+  else if(not stimuli.FriendBehind() ){
+    return fsm->GetState(STATE_CRUISE);
   }
-  else if(friendBehind and not friendAhead){
-    return new StateAlign();
+  else if(stimuli.FriendBehind() and not stimuli.FriendAhead()){
+    return fsm->GetState(STATE_ALIGN);
   }
-  else if( not friendBehind){
-    return new StateCatchUp();
+  else if( not stimuli.FriendBehind()){
+    return fsm->GetState(STATE_CATCH_UP);
   }
   else{
     return NULL;
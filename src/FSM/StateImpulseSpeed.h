@@ -6,6 +6,7 @@
 #include <string>
 
 #include "State.h"
+#include "PidController.h"
 
 #include "FSM.h"
 
@@ -16,10 +17,10 @@ class StateImpulseSpeed: public State{
   StateImpulseSpeed();
 
   void Enter();
-  void Execute(StateManager * fsm);
+  void Execute(StateManager * fsm, const SensorSnapshot& sensors);
   void Exit();
   
-  State * Transition(bool* stimuli);
+  State * Transition(StateManager * fsm, const SensorSnapshot& sensors);
 
   void Print();
   
@@ -28,6 +29,7 @@ class StateImpulseSpeed: public State{
   private:
 
   string name;
+  PidController steering;
 
 };
 #endif
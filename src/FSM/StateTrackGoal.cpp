@@ -16,7 +16,7 @@ void StateTrackGoal::Execute(StateManager* fsm){
   printf("Executing behaviour trackGoal...\n");
 
   float trackingError = fsm->GetRotControlErrorGoal();
-  float kp = fsm->GetProportionalGain();
+  float kp = fsm->GetParams().catchUpKp;
   
   fsm->SetRotSpeed(kp*trackingError);
   fsm->SetTransSpeed(1);
@@ -15,7 +15,7 @@ void StateTrackPuck::Execute(StateManager * fsm){
   printf("Executing behaviour %s...\n", name.c_str());
 
   float trackingError = fsm->GetRotControlErrorPuck();
-  float kp = fsm->GetProportionalGain();
+  float kp = fsm->GetParams().catchUpKp;
   
   fsm->SetRotSpeed(kp*trackingError);
   fsm->SetTransSpeed(1);
@@ -3,9 +3,22 @@
 class blobClass{
 public:
   
-  blobClass(){};
+  blobClass(){ trackId = -1; bearingRate = 0.; };
 
   float blobBearing;
   float blobArea;
+
+  // Unit vector of blobBearing, kept alongside it so bearing statistics
+  // need no trigonometry. These first four floats are contiguous, so the
+  // formation kernel reads them with one SSE load; the tracker fields
+  // below must stay after them.
+  float blobCos;
+  float blobSin;
+
+  // Filled in by BlobTracker: the id of the team mate this blob has been
+  // associated with (-1 if untracked) and its bearing rate in radians per
+  // second.
+  int trackId;
+  float bearingRate;
 };
 #endif
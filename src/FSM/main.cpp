@@ -1,52 +1,402 @@
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include <stdint.h>
 #include <string>
+#include <vector>
+
 #include "FSM.h"
+#include "blobClass.h"
+#include "ControllerParams.h"
 
 using namespace std;
 
-int main(){
-
-  // seePuck, havePuck, seeGoal, atGoal, movingForward, puck2Close2Goal, prox
-  bool stimuli[7] = {0,0,0,0,0,0,0};
-  string stimuliArray[7] = {"seePuck", "havePuck", "seeGoal", "atGoal", 
-			    "movingForward", "puck2Close2Goal", "prox"}; 
-  
-  StateManager* fsm = new StateManager();
-  
-  bool keepGoing = true;
-
-  char response;
-
-  while(keepGoing){
-
-    printf("Current State = ");
-    fsm->PrintCurrentState();
-        
-    for(int i = 0; i < 7; i++){
-      printf("%s: ", stimuliArray[i].c_str());
-      char c; 
-      scanf("%s", &c);
-      if(c == 'y')
-	stimuli[i] = true;
-      else
-	stimuli[i] = false;
+//===========================================================================
+// Scripted stimulus replay for the state machine
+//
+//   botFsmReplay (--script=file | --generate=STEPS [--seed=X] [--dt=T])
+//                [--save-script=file] [--start=State] [--repeat=R]
+//                [--trace=file] [--diff=reference] [--show-diffs=M]
+//                [controller parameters, see ControllerParams.h]
+//
+// Drives StateManager through a sequence of steps as fast as it will go and
+// records the state, translational and rotational speed after every step.
+// A script has one step per line, '#' starts a comment:
+//
+//   <8 stimuli as 0/1> <magneticHeadingError> <formationHeadingError>
+//   <time> [bearing:area ...]
+//
+// with the stimuli in BotController's order (frontProx, rearProx,
+// friendLeft, friendRight, friendAhead, friendBehind, aligned,
+// closingFast; scripts written with 7 leave it off) and the
+// optional blob frame as bearing:area pairs. --generate makes a random walk
+// script instead. --trace writes the state trace as text; --diff compares
+// it with a trace from another build and exits with status 2 on any
+// difference, so behavioural changes show up as a failing run.
+//===========================================================================
+
+struct Step{
+  uint8_t stimuli;          // bit i is stimulus i
+  float magneticHeadingError;
+  float formationHeadingError;
+  float time;
+  int firstBlob;
+  int blobCount;
+};
+
+struct Script{
+  vector<Step> steps;
+  vector<blobClass> blobs;
+};
+
+struct TraceEntry{
+  uint8_t state;
+  float trans;
+  float rot;
+};
+
+static const char* kStateNames[] = {
+  "Align", "Cruise", "CatchUp", "Halt", "ImpulseSpeed", "Evade"
+};
+static const int kNumStates = sizeof(kStateNames) / sizeof(kStateNames[0]);
+
+//===========================================================================
+// Helper Functions
+//===========================================================================
+static unsigned int randomState = 1;
+
+static float Uniform(){
+  randomState ^= randomState << 13;
+  randomState ^= randomState >> 17;
+  randomState ^= randomState << 5;
+  return (randomState >> 8) / 16777216.;
+}
+
+static double WallSeconds(){
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static int StateIndex(const string& name){
+  for(int i = 0; i < kNumStates; i++)
+    if(name == kStateNames[i])
+      return i;
+  return kNumStates;
+}
+
+static const char* StateName(int index){
+  return index < kNumStates ? kStateNames[index] : "Unknown";
+}
+
+static bool SameValue(float a, float b){
+  return fabs(a - b) <= 1e-5 * (1. + fabs(b));
+}
+
+//===========================================================================
+// Scripts
+//===========================================================================
+static bool LoadScript(const char* path, Script& script){
+  FILE* file = fopen(path, "r");
+  if(file == NULL){
+    printf("Could not open %s\n", path);
+    return false;
+  }
+
+  char line[4096];
+  int lineNumber = 0;
+  while(fgets(line, sizeof(line), file) != NULL){
+    lineNumber++;
+    char* comment = strchr(line, '#');
+    if(comment != NULL)
+      *comment = '\0';
+
+    char bits[16];
+    Step step;
+    int consumed = 0;
+    int fields = sscanf(line, "%15s %f %f %f%n", bits, &step.magneticHeadingError,
+			&step.formationHeadingError, &step.time, &consumed);
+    if(fields <= 0)
+      continue;
+    int numberOfBits = strlen(bits);
+    if(fields < 4 or numberOfBits < kNumStimuli - 1 or numberOfBits > kNumStimuli){
+      printf("%s:%d: expected %d stimuli, two heading errors and a time\n", path,
+	     lineNumber, kNumStimuli);
+      fclose(file);
+      return false;
     }
 
-    fsm->UpdateBehaviour(stimuli);
-    
-    fsm->ExecuteBehaviour();
-
-    printf("Keep Going? ");
-    scanf("%s", &response);
-    if(response == 'y')
-      keepGoing = true;
-    else
-      keepGoing = false;
-  
-    printf("=============================\n");
-  }
-  
-  printf("Exiting...\n");
+    step.stimuli = 0;
+    for(int i = 0; i < numberOfBits; i++)
+      if(bits[i] == '1')
+	step.stimuli |= 1 << i;
+
+    step.firstBlob = script.blobs.size();
+    step.blobCount = 0;
+    const char* cursor = line + consumed;
+    blobClass blob;
+    int blobLength = 0;
+    while(sscanf(cursor, " %f:%f%n", &blob.blobBearing, &blob.blobArea, &blobLength) == 2){
+      blob.blobCos = cos(blob.blobBearing);
+      blob.blobSin = sin(blob.blobBearing);
+      script.blobs.push_back(blob);
+      step.blobCount++;
+      cursor += blobLength;
+    }
+
+    script.steps.push_back(step);
+  }
+
+  fclose(file);
+  return true;
+}
+
+// Stimuli flip now and then, heading errors wander, blobs come and go
+static void GenerateScript(long steps, float dt, Script& script){
+  uint8_t stimuli = 0;
+  float magneticHeadingError = 0.;
+  float formationHeadingError = 0.;
+
+  script.steps.reserve(steps);
+  for(long s = 0; s < steps; s++){
+    for(int i = 0; i < kNumStimuli; i++)
+      if(Uniform() < 0.05)
+	stimuli ^= 1 << i;
+
+    magneticHeadingError += 0.1 * (Uniform() - 0.5);
+    formationHeadingError += 0.1 * (Uniform() - 0.5);
+
+    Step step;
+    step.stimuli = stimuli;
+    step.magneticHeadingError = magneticHeadingError;
+    step.formationHeadingError = formationHeadingError;
+    step.time = s * dt;
+    step.firstBlob = script.blobs.size();
+    step.blobCount = Uniform() * 8;
+    for(int b = 0; b < step.blobCount; b++){
+      blobClass blob;
+      blob.blobBearing = (Uniform() - 0.5) * 2.*M_PI;
+      blob.blobArea = 0.01 * Uniform();
+      blob.blobCos = cos(blob.blobBearing);
+      blob.blobSin = sin(blob.blobBearing);
+      script.blobs.push_back(blob);
+    }
+    script.steps.push_back(step);
+  }
+}
+
+static bool SaveScript(const char* path, const Script& script){
+  FILE* file = fopen(path, "w");
+  if(file == NULL){
+    printf("Could not write %s\n", path);
+    return false;
+  }
+
+  fprintf(file, "# stimuli magneticHeadingError formationHeadingError time [bearing:area ...]\n");
+  for(size_t s = 0; s < script.steps.size(); s++){
+    const Step& step = script.steps[s];
+    for(int i = 0; i < kNumStimuli; i++)
+      fputc((step.stimuli >> i) & 1 ? '1' : '0', file);
+    fprintf(file, " %.9g %.9g %.9g", step.magneticHeadingError,
+	    step.formationHeadingError, step.time);
+    for(int b = 0; b < step.blobCount; b++){
+      const blobClass& blob = script.blobs[step.firstBlob + b];
+      fprintf(file, " %.9g:%.9g", blob.blobBearing, blob.blobArea);
+    }
+    fprintf(file, "\n");
+  }
+  fclose(file);
+  return true;
+}
+
+//===========================================================================
+// Traces
+//===========================================================================
+static bool WriteTrace(const char* path, const vector<TraceEntry>& trace){
+  FILE* file = fopen(path, "w");
+  if(file == NULL){
+    printf("Could not write %s\n", path);
+    return false;
+  }
+  long count = trace.size();
+  for(long i = 0; i < count; i++)
+    fprintf(file, "%ld %s %.9g %.9g\n", i, StateName(trace[i].state), trace[i].trans,
+	    trace[i].rot);
+  fclose(file);
+  return true;
+}
+
+static bool ReadTrace(const char* path, vector<TraceEntry>& trace){
+  FILE* file = fopen(path, "r");
+  if(file == NULL){
+    printf("Could not open %s\n", path);
+    return false;
+  }
+
+  long step;
+  char name[32];
+  TraceEntry entry;
+  while(fscanf(file, "%ld %31s %f %f", &step, name, &entry.trans, &entry.rot) == 4){
+    entry.state = StateIndex(name);
+    trace.push_back(entry);
+  }
+  fclose(file);
+  return true;
+}
+
+static long DiffTraces(const vector<TraceEntry>& trace, const vector<TraceEntry>& reference,
+		       int showDiffs){
+  long differences = 0;
+  long common = trace.size() < reference.size() ? trace.size() : reference.size();
+
+  for(long i = 0; i < common; i++){
+    const TraceEntry& a = trace[i];
+    const TraceEntry& b = reference[i];
+    if(a.state == b.state and SameValue(a.trans, b.trans) and SameValue(a.rot, b.rot))
+      continue;
+
+    differences++;
+    if(differences <= showDiffs)
+      printf("step %ld: %s trans=%.6g rot=%.6g, reference %s trans=%.6g rot=%.6g\n", i,
+	     StateName(a.state), a.trans, a.rot, StateName(b.state), b.trans, b.rot);
+  }
+
+  if(trace.size() != reference.size()){
+    printf("Trace has %lu steps, reference %lu\n", (unsigned long)trace.size(),
+	   (unsigned long)reference.size());
+    differences += labs((long)trace.size() - (long)reference.size());
+  }
+  return differences;
+}
+
+//===========================================================================
+// Main Function
+//===========================================================================
+int main(int argc, char* argv[]){
+
+  const char* scriptPath = NULL;
+  const char* savePath = NULL;
+  const char* tracePath = NULL;
+  const char* referencePath = NULL;
+  const char* startState = NULL;
+  long generateSteps = 0;
+  float dt = 0.05;
+  int repeat = 1;
+  int showDiffs = 10;
+
+  ControllerParams params;
+  DefaultControllerParams(params);
+
+  for(int i = 1; i < argc; i++){
+    if(strncmp(argv[i], "--script=", 9) == 0)
+      scriptPath = argv[i] + 9;
+    else if(strncmp(argv[i], "--generate=", 11) == 0)
+      generateSteps = atol(argv[i] + 11);
+    else if(strncmp(argv[i], "--seed=", 7) == 0)
+      randomState = strtoul(argv[i] + 7, NULL, 10) * 2654435761u + 1;
+    else if(strncmp(argv[i], "--dt=", 5) == 0)
+      dt = atof(argv[i] + 5);
+    else if(strncmp(argv[i], "--save-script=", 14) == 0)
+      savePath = argv[i] + 14;
+    else if(strncmp(argv[i], "--start=", 8) == 0)
+      startState = argv[i] + 8;
+    else if(strncmp(argv[i], "--repeat=", 9) == 0)
+      repeat = atoi(argv[i] + 9);
+    else if(strncmp(argv[i], "--trace=", 8) == 0)
+      tracePath = argv[i] + 8;
+    else if(strncmp(argv[i], "--diff=", 7) == 0)
+      referencePath = argv[i] + 7;
+    else if(strncmp(argv[i], "--show-diffs=", 13) == 0)
+      showDiffs = atoi(argv[i] + 13);
+    else if(ParseControllerParam(argv[i], params))
+      continue;
+    else{
+      printf("Unknown option %s\n", argv[i]);
+      return 1;
+    }
+  }
+
+  Script script;
+  if(scriptPath != NULL){
+    if(not LoadScript(scriptPath, script))
+      return 1;
+  }
+  else if(generateSteps > 0){
+    GenerateScript(generateSteps, dt, script);
+  }
+  else{
+    printf("Give a --script=file or --generate=steps\n");
+    return 1;
+  }
+  if(savePath != NULL and not SaveScript(savePath, script))
+    return 1;
+
+  // The trace of the first pass is kept; further passes only add to the
+  // throughput figure
+  vector<TraceEntry> trace(script.steps.size());
+  vector<blobClass*> frame;
+  frame.reserve(64);
+  SensorSnapshot sensors;
+  long transitions = 0;
+
+  double start = WallSeconds();
+  for(int r = 0; r < repeat; r++){
+    StateManager fsm(params);
+    if(startState != NULL and not fsm.SetCurrentState(startState)){
+      printf("Unknown state %s\n", startState);
+      return 1;
+    }
+    int lastState = StateIndex(fsm.GetCurrentStateName());
+
+    for(size_t s = 0; s < script.steps.size(); s++){
+      const Step& step = script.steps[s];
+
+      frame.clear();
+      for(int b = 0; b < step.blobCount; b++)
+	frame.push_back(&script.blobs[step.firstBlob + b]);
+
+      // The script's stimulus bits are already a Stimuli mask
+      sensors.stimuli = Stimuli(step.stimuli);
+      sensors.magneticHeadingError = step.magneticHeadingError;
+      sensors.formationHeadingError = step.formationHeadingError;
+      sensors.blobs = &frame;
+      sensors.time = step.time;
+      sensors.headingTime = step.time;
+      sensors.omniTime = step.time;
+
+      // Same order as BotController
+      fsm.UpdateBehaviour(sensors);
+
+      TraceEntry& entry = trace[s];
+      bool servoOpen;
+      fsm.ExecuteBehaviour(sensors, entry.trans, entry.rot, servoOpen);
+      entry.state = StateIndex(fsm.GetCurrentStateName());
+      if(entry.state != lastState)
+	transitions++;
+      lastState = entry.state;
+    }
+  }
+  double elapsed = WallSeconds() - start;
+
+  long totalSteps = (long)script.steps.size() * repeat;
+  printf("%ld steps (%ld transitions) in %.3f s: %.0f steps/s\n", totalSteps, transitions,
+	 elapsed, totalSteps / elapsed);
+
+  if(tracePath != NULL and not WriteTrace(tracePath, trace))
+    return 1;
+
+  if(referencePath != NULL){
+    vector<TraceEntry> reference;
+    if(not ReadTrace(referencePath, reference))
+      return 1;
+    long differences = DiffTraces(trace, reference, showDiffs);
+    printf("%ld of %lu steps differ from %s\n", differences,
+	   (unsigned long)script.steps.size(), referencePath);
+    if(differences > 0)
+      return 2;
+  }
+
   return 0;
 }
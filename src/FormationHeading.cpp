@@ -0,0 +1,94 @@
+#include <math.h>
+#include <vector>
+
+#ifdef __SSE__
+#include <xmmintrin.h>
+#endif
+
+#include "FormationHeading.h"
+#include "FSM/blobClass.h"
+
+using namespace std;
+
+static float WrapAngle(float angle){
+  while(angle > M_PI)
+    angle -= 2.*M_PI;
+  while(angle <= -M_PI)
+    angle += 2.*M_PI;
+  return angle;
+}
+
+void FormationAxisScalar(const blobClass* const* blobs, int n, FormationAxis& axis){
+  axis.sumCos2 = 0.;
+  axis.sumSin2 = 0.;
+  axis.sumWeight = 0.;
+
+  for(int i = 0; i < n; i++){
+    float c = blobs[i]->blobCos;
+    float s = blobs[i]->blobSin;
+    float weight = blobs[i]->blobArea * (c*c)*(c*c);
+    axis.sumCos2 += weight * (c*c - s*s);
+    axis.sumSin2 += weight * 2.f*c*s;
+    axis.sumWeight += weight;
+  }
+}
+
+void FormationAxisSums(const blobClass* const* blobs, int n, FormationAxis& axis){
+#ifdef __SSE__
+  // One unaligned load takes the first four floats of a blob,
+  // {bearing, area, cos, sin}; the tracker fields after them are not read.
+  // A 4x4 transpose turns four blobs into one register per field.
+  __m128 sumCos2 = _mm_setzero_ps();
+  __m128 sumSin2 = _mm_setzero_ps();
+  __m128 sumWeight = _mm_setzero_ps();
+
+  int i = 0;
+  for(; i + 4 <= n; i += 4){
+    __m128 bearing = _mm_loadu_ps(&blobs[i]->blobBearing);
+    __m128 area = _mm_loadu_ps(&blobs[i + 1]->blobBearing);
+    __m128 c = _mm_loadu_ps(&blobs[i + 2]->blobBearing);
+    __m128 s = _mm_loadu_ps(&blobs[i + 3]->blobBearing);
+    _MM_TRANSPOSE4_PS(bearing, area, c, s);
+
+    __m128 cc = _mm_mul_ps(c, c);
+    __m128 weight = _mm_mul_ps(area, _mm_mul_ps(cc, cc));
+    __m128 cos2 = _mm_sub_ps(cc, _mm_mul_ps(s, s));
+    __m128 cs = _mm_mul_ps(c, s);
+    __m128 sin2 = _mm_add_ps(cs, cs);
+
+    sumCos2 = _mm_add_ps(sumCos2, _mm_mul_ps(weight, cos2));
+    sumSin2 = _mm_add_ps(sumSin2, _mm_mul_ps(weight, sin2));
+    sumWeight = _mm_add_ps(sumWeight, weight);
+  }
+
+  float lanes[3][4];
+  _mm_storeu_ps(lanes[0], sumCos2);
+  _mm_storeu_ps(lanes[1], sumSin2);
+  _mm_storeu_ps(lanes[2], sumWeight);
+
+  FormationAxisScalar(blobs + i, n - i, axis);
+  for(int lane = 0; lane < 4; lane++){
+    axis.sumCos2 += lanes[0][lane];
+    axis.sumSin2 += lanes[1][lane];
+    axis.sumWeight += lanes[2][lane];
+  }
+#else
+  FormationAxisScalar(blobs, n, axis);
+#endif
+}
+
+float FormationHeadingError(const vector<blobClass*>& blobs, float magneticHeadingError){
+  float heldHeading = WrapAngle(magneticHeadingError);
+  if(blobs.empty())
+    return heldHeading;
+
+  FormationAxis axis;
+  FormationAxisSums(&blobs[0], blobs.size(), axis);
+
+  float resultant = sqrt(axis.sumCos2*axis.sumCos2 + axis.sumSin2*axis.sumSin2);
+  if(axis.sumWeight <= 0. or resultant < kFormationMinResultant * axis.sumWeight)
+    return heldHeading;
+
+  float axisBearing = 0.5 * atan2(axis.sumSin2, axis.sumCos2);
+  return WrapAngle(axisBearing + magneticHeadingError);
+}
@@ -0,0 +1,47 @@
+#ifndef FORMATION_HEADING_H
+#define FORMATION_HEADING_H
+
+#include <vector>
+
+#include "FSM/blobClass.h"
+
+using namespace std;
+
+// Estimates which way the line of visible team mates runs and turns that
+// into a steering error for the formation keeping states.
+//
+// Neighbour bearings are axial data (a friend ahead and a friend behind lie
+// on the same line), so their mean is taken over doubled angles:
+//
+//   C = sum(w cos 2b), S = sum(w sin 2b), axis = atan2(S, C) / 2
+//
+// with bearings b relative to the target heading and weights
+// w = area * cos^4(b). The area makes close robots count for more; the
+// cos^4 term keeps robots abeam from pulling the axis sideways, so the
+// swarm closes up into a column along the target heading rather than
+// turning into it.
+//
+// The axis is relative to the target heading, in (-pi/2, pi/2]. The error
+// is that axis seen from the current heading, wrap(axis + magneticError),
+// with the same sign convention as the magnetic heading error (positive
+// turns clockwise). A single neighbour gives the line towards it. When no
+// neighbour is seen, or their bearings do not agree on a line (mean
+// resultant length below kFormationMinResultant), the target heading is
+// held instead and the magnetic heading error is returned.
+
+const float kFormationMinResultant = 0.3;
+
+struct FormationAxis{
+  float sumCos2;     // sum of w cos 2b, w = area * cos^4(b)
+  float sumSin2;     // sum of w sin 2b
+  float sumWeight;   // sum of w
+};
+
+// Accumulates the weighted doubled angle sums over n blobs. Uses SSE four blobs at a
+// time where available; FormationAxisScalar is the reference version.
+void FormationAxisSums(const blobClass* const* blobs, int n, FormationAxis& axis);
+void FormationAxisScalar(const blobClass* const* blobs, int n, FormationAxis& axis);
+
+float FormationHeadingError(const vector<blobClass*>& blobs, float magneticHeadingError);
+
+#endif
@@ -0,0 +1,59 @@
+#include <math.h>
+
+#include "HeadingEstimator.h"
+
+static float WrapAngle(float angle){
+  while(angle > M_PI)
+    angle -= 2.*M_PI;
+  while(angle <= -M_PI)
+    angle += 2.*M_PI;
+  return angle;
+}
+
+HeadingEstimator::HeadingEstimator(){
+  Reset();
+};
+
+void HeadingEstimator::Reset(){
+  error = 0.;
+  rate = 0.;
+  lastTime = 0.;
+  haveReading = false;
+  rateError = 0.;
+  rateTime = 0.;
+};
+
+void HeadingEstimator::Update(double yaw, float time){
+  float newError = WrapAngle(yaw - kTargetHeading);
+
+  // Start the rate over on the first reading or if time runs backwards,
+  // as it does when the simulation is restarted
+  if(not haveReading or time < rateTime){
+    rateError = newError;
+    rateTime = time;
+    rate = 0.;
+  }
+  else if(time > rateTime){
+    float dt = time - rateTime;
+    float measuredRate = WrapAngle(newError - rateError) / dt;
+    rate += dt / (kHeadingRateTimeConstant + dt) * (measuredRate - rate);
+    rateError = newError;
+    rateTime = time;
+  }
+
+  error = newError;
+  lastTime = time;
+  haveReading = true;
+};
+
+float HeadingEstimator::GetError(){
+  return error;
+};
+
+float HeadingEstimator::GetRate(){
+  return rate;
+};
+
+float HeadingEstimator::GetTime(){
+  return lastTime;
+};
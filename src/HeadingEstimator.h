@@ -0,0 +1,50 @@
+#ifndef HEADING_ESTIMATOR_H
+#define HEADING_ESTIMATOR_H
+
+#include <math.h>
+
+// Heading error against the swarm's target heading, and how fast it is
+// changing, from the body orientation readings.
+//
+// The error is the body yaw less the target heading, wrapped to (-pi, pi]
+// so a robot facing just past the opposite way turns the short way round
+// rather than through a full circle. Positive errors turn clockwise.
+//
+// The orientation sensor gives no rate, so the rate is the wrapped change
+// between readings over the time between them, smoothed with a first
+// order low pass of time constant kHeadingRateTimeConstant. A reading with
+// the same time stamp as the last updates the error, and its change is
+// counted towards the rate at the next reading that moves the time on.
+
+// World frame yaw (radians, counter clockwise) the swarm lines up on
+const float kTargetHeading = -M_PI/2.;
+const float kHeadingRateTimeConstant = 0.1;   // seconds
+
+class HeadingEstimator{
+
+ public:
+
+  HeadingEstimator();
+
+  void Reset();
+
+  // yaw is the body's in the world frame, time in seconds
+  void Update(double yaw, float time);
+
+  float GetError();         // radians, (-pi, pi]
+  float GetRate();          // radians per second
+  float GetTime();          // of the last reading
+
+ private:
+
+  float error;
+  float rate;
+  float lastTime;
+  bool haveReading;
+
+  // Error and time the next rate sample is measured from
+  float rateError;
+  float rateTime;
+};
+
+#endif
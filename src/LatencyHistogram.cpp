@@ -0,0 +1,106 @@
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+
+#include "LatencyHistogram.h"
+
+LatencyHistogram::LatencyHistogram(){
+  Reset();
+};
+
+void LatencyHistogram::Reset(){
+  memset(counts, 0, sizeof(counts));
+  count = 0;
+  min = UINT64_MAX;
+  max = 0;
+  sum = 0.;
+};
+
+// Values below kSubBuckets map linearly onto the first row. Above that the
+// row is picked by the position of the top bit and the column by the next
+// kSubBucketBits bits.
+int LatencyHistogram::BucketIndex(uint64_t value){
+  if(value < (uint64_t)kSubBuckets)
+    return (int)value;
+
+  int topBit = 63 - __builtin_clzll(value);
+  int row = topBit - kSubBucketBits + 1;
+  int column = (int)((value >> (topBit - kSubBucketBits)) & (kSubBuckets - 1));
+
+  return row * kSubBuckets + column;
+};
+
+uint64_t LatencyHistogram::BucketUpperEdge(int index){
+  int row = index / kSubBuckets;
+  int column = index % kSubBuckets;
+
+  if(row == 0)
+    return (uint64_t)column;
+
+  int shift = row - 1;
+  uint64_t base = (uint64_t)(kSubBuckets + column) << shift;
+  return base + ((uint64_t)1 << shift) - 1;
+};
+
+void LatencyHistogram::Record(uint64_t nanoseconds){
+  counts[BucketIndex(nanoseconds)]++;
+  count++;
+  sum += (double)nanoseconds;
+  if(nanoseconds < min)
+    min = nanoseconds;
+  if(nanoseconds > max)
+    max = nanoseconds;
+};
+
+uint64_t LatencyHistogram::GetCount() const{
+  return count;
+};
+
+uint64_t LatencyHistogram::GetMin() const{
+  return count > 0 ? min : 0;
+};
+
+uint64_t LatencyHistogram::GetMax() const{
+  return max;
+};
+
+double LatencyHistogram::GetMean() const{
+  return count > 0 ? sum / (double)count : 0.;
+};
+
+uint64_t LatencyHistogram::GetPercentile(double percentile) const{
+  if(count == 0)
+    return 0;
+
+  uint64_t target = (uint64_t)(percentile / 100. * (double)count + 0.5);
+  if(target < 1)
+    target = 1;
+
+  uint64_t seen = 0;
+  for(int i = 0; i < kBuckets; i++){
+    seen += counts[i];
+    if(seen >= target){
+      uint64_t edge = BucketUpperEdge(i);
+      return edge < max ? edge : max;
+    }
+  }
+  return max;
+};
+
+int LatencyHistogram::Format(char* buffer, int bufferSize, const char* label) const{
+  int n = snprintf(buffer, bufferSize,
+		   "%s n=%llu min=%.1f p50=%.1f p90=%.1f p99=%.1f p99.9=%.1f max=%.1f mean=%.1f us\n",
+		   label, (unsigned long long)count,
+		   GetMin() / 1000., GetPercentile(50.) / 1000., GetPercentile(90.) / 1000.,
+		   GetPercentile(99.) / 1000., GetPercentile(99.9) / 1000.,
+		   GetMax() / 1000., GetMean() / 1000.);
+  if(n >= bufferSize)
+    n = bufferSize - 1;
+  return n;
+};
+
+void LatencyHistogram::Print(FILE* stream, const char* label) const{
+  char line[256];
+  Format(line, sizeof(line), label);
+  fputs(line, stream);
+};
@@ -0,0 +1,80 @@
+#include <stdio.h>
+#include <stdint.h>
+
+#include "LatencyTracer.h"
+
+static const char* stageNames[LATENCY_STAGE_COUNT] = {
+  "transport", "decode", "wait", "update", "execute", "publish", "end-to-end"
+};
+
+LatencyTracer::LatencyTracer(){
+  pendingInput = false;
+  pendingStampNs = 0;
+  pendingReceiveNs = 0;
+  tickHasInput = false;
+  tickStampNs = 0;
+  phaseStartNs = 0;
+};
+
+void LatencyTracer::SensorDecoded(uint64_t stampNs, uint64_t receiveRosNs,
+				  uint64_t decodeStartNs, uint64_t decodeEndNs){
+
+  // A zero stamp means the publisher did not fill the header in
+  if(stampNs != 0 and receiveRosNs >= stampNs)
+    histograms[LATENCY_TRANSPORT].Record(receiveRosNs - stampNs);
+  histograms[LATENCY_DECODE].Record(decodeEndNs - decodeStartNs);
+
+  if(stampNs == 0)
+    stampNs = receiveRosNs;
+
+  if(not pendingInput or stampNs < pendingStampNs)
+    pendingStampNs = stampNs;
+  if(not pendingInput or decodeStartNs < pendingReceiveNs)
+    pendingReceiveNs = decodeStartNs;
+  pendingInput = true;
+};
+
+void LatencyTracer::BeginUpdate(uint64_t nowNs){
+  tickHasInput = pendingInput;
+  if(pendingInput){
+    tickStampNs = pendingStampNs;
+    histograms[LATENCY_WAIT].Record(nowNs - pendingReceiveNs);
+  }
+  pendingInput = false;
+  phaseStartNs = nowNs;
+};
+
+void LatencyTracer::EndUpdate(uint64_t nowNs){
+  histograms[LATENCY_UPDATE].Record(nowNs - phaseStartNs);
+  phaseStartNs = nowNs;
+};
+
+void LatencyTracer::EndExecute(uint64_t nowNs){
+  histograms[LATENCY_EXECUTE].Record(nowNs - phaseStartNs);
+  phaseStartNs = nowNs;
+};
+
+void LatencyTracer::EndPublish(uint64_t nowNs, uint64_t publishRosNs){
+  histograms[LATENCY_PUBLISH].Record(nowNs - phaseStartNs);
+
+  // Ticks that consumed no new input say nothing about data age
+  if(tickHasInput and publishRosNs >= tickStampNs)
+    histograms[LATENCY_END_TO_END].Record(publishRosNs - tickStampNs);
+  tickHasInput = false;
+};
+
+const LatencyHistogram& LatencyTracer::GetHistogram(int stage) const{
+  return histograms[stage];
+};
+
+int LatencyTracer::Format(char* buffer, int bufferSize) const{
+  int used = 0;
+  for(int i = 0; i < LATENCY_STAGE_COUNT and used < bufferSize - 1; i++)
+    used += histograms[i].Format(buffer + used, bufferSize - used, stageNames[i]);
+  return used;
+};
+
+void LatencyTracer::Print(FILE* stream) const{
+  for(int i = 0; i < LATENCY_STAGE_COUNT; i++)
+    histograms[i].Print(stream, stageNames[i]);
+};
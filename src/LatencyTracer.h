@@ -0,0 +1,62 @@
+#ifndef LATENCY_TRACER_H
+#define LATENCY_TRACER_H
+
+#include <stdio.h>
+#include <stdint.h>
+
+#include "LatencyHistogram.h"
+
+// Follows sensor data from its header stamp to the wheel command it ends up
+// driving. Sensor callbacks report their stamp, receive time and decode
+// cost; the control loop then marks each phase of the tick. The oldest input
+// consumed by a tick is what the end-to-end figure is measured against.
+//
+// Stamps and receive/publish times are in ROS time, phase times on the
+// monotonic clock, all in nanoseconds.
+enum LatencyStage{
+  LATENCY_TRANSPORT = 0,  // header stamp -> callback
+  LATENCY_DECODE,         // callback duration
+  LATENCY_WAIT,           // callback -> UpdateBehaviour
+  LATENCY_UPDATE,         // UpdateBehaviour
+  LATENCY_EXECUTE,        // ExecuteBehaviour
+  LATENCY_PUBLISH,        // building and publishing the wheel command
+  LATENCY_END_TO_END,     // header stamp -> wheel publish
+  LATENCY_STAGE_COUNT
+};
+
+class LatencyTracer{
+
+ public:
+
+  LatencyTracer();
+
+  void SensorDecoded(uint64_t stampNs, uint64_t receiveRosNs,
+		     uint64_t decodeStartNs, uint64_t decodeEndNs);
+
+  void BeginUpdate(uint64_t nowNs);
+  void EndUpdate(uint64_t nowNs);
+  void EndExecute(uint64_t nowNs);
+  void EndPublish(uint64_t nowNs, uint64_t publishRosNs);
+
+  const LatencyHistogram& GetHistogram(int stage) const;
+
+  // All stages, one line each. Returns the number of characters written.
+  int Format(char* buffer, int bufferSize) const;
+  void Print(FILE* stream) const;
+
+ private:
+
+  LatencyHistogram histograms[LATENCY_STAGE_COUNT];
+
+  // Oldest input received since the last tick
+  bool pendingInput;
+  uint64_t pendingStampNs;
+  uint64_t pendingReceiveNs;
+
+  // Oldest input consumed by the current tick
+  bool tickHasInput;
+  uint64_t tickStampNs;
+
+  uint64_t phaseStartNs;
+};
+#endif
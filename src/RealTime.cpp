@@ -0,0 +1,194 @@
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <sched.h>
+#include <pthread.h>
+#include <malloc.h>
+#include <alloca.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+
+#include "RealTime.h"
+
+void DefaultRealTimeConfig(RealTimeConfig& config){
+  config.lockMemory = false;
+  config.stackPrefault = 512*1024;
+  config.heapPrefault = 8*1024*1024;
+  config.controlCpu = -1;
+  config.fifoPriority = 0;
+}
+
+bool ParseRealTimeOption(const char* arg, RealTimeConfig& config){
+  if(strcmp(arg, "--rt") == 0){
+    config.lockMemory = true;
+  }
+  else if(strncmp(arg, "--rt-cpu=", 9) == 0){
+    // Out of range values would index past the cpu_set_t bitmask
+    char* end;
+    long cpu = strtol(arg + 9, &end, 10);
+    if(end == arg + 9 or *end != '\0' or cpu < 0 or cpu >= CPU_SETSIZE){
+      printf("Real-time: --rt-cpu=%s is not a CPU number in [0, %d), ignored\n",
+	     arg + 9, CPU_SETSIZE);
+      config.controlCpu = -1;
+    }
+    else
+      config.controlCpu = (int)cpu;
+  }
+  else if(strncmp(arg, "--rt-fifo=", 10) == 0){
+    // 0 keeps SCHED_OTHER, anything else must be a SCHED_FIFO priority
+    char* end;
+    long priority = strtol(arg + 10, &end, 10);
+    int lowest = sched_get_priority_min(SCHED_FIFO);
+    int highest = sched_get_priority_max(SCHED_FIFO);
+    if(end == arg + 10 or *end != '\0' or
+       (priority != 0 and (priority < lowest or priority > highest))){
+      printf("Real-time: --rt-fifo=%s is not 0 or a SCHED_FIFO priority in [%d, %d], ignored\n",
+	     arg + 10, lowest, highest);
+      config.fifoPriority = 0;
+    }
+    else
+      config.fifoPriority = (int)priority;
+  }
+  else{
+    return false;
+  }
+  return true;
+}
+
+uint64_t MonotonicNanoseconds(){
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+//===========================================================================
+// Helper Functions
+//===========================================================================
+
+// Touch every page of a stack frame of the given size so later deep calls
+// don't page fault inside the loop.
+static void PrefaultStack(size_t size){
+  volatile unsigned char* frame = (volatile unsigned char*)alloca(size);
+  long pageSize = sysconf(_SC_PAGESIZE);
+  for(size_t i = 0; i < size; i += pageSize)
+    frame[i] = 0;
+}
+
+// Grow the heap once and hand it back to malloc without returning it to the
+// kernel. Together with mlockall the pages stay resident.
+static void PrefaultHeap(size_t size){
+  mallopt(M_TRIM_THRESHOLD, -1);
+  mallopt(M_MMAP_MAX, 0);
+
+  unsigned char* block = (unsigned char*)malloc(size);
+  if(block == NULL)
+    return;
+  long pageSize = sysconf(_SC_PAGESIZE);
+  for(size_t i = 0; i < size; i += pageSize)
+    block[i] = 0;
+  free(block);
+}
+
+// Whether the control thread can be pinned to cpu. The process's affinity
+// mask only ever holds online CPUs, so this also rules out offline ones and
+// those excluded by taskset or a cpuset.
+static bool CpuUsable(int cpu){
+  if(cpu < 0 or cpu >= CPU_SETSIZE)
+    return false;
+
+  cpu_set_t allowed;
+  if(sched_getaffinity(0, sizeof(allowed), &allowed) != 0)
+    return false;
+  return CPU_ISSET(cpu, &allowed);
+}
+
+// Keep every other thread in the process (ROS spinner, poll and xmlrpc
+// threads) off the control CPU.
+static int MoveOtherThreadsOffCpu(int cpu){
+  pid_t self = (pid_t)syscall(SYS_gettid);
+  DIR* tasks = opendir("/proc/self/task");
+  if(tasks == NULL)
+    return -1;
+
+  int failures = 0;
+  struct dirent* entry;
+  while((entry = readdir(tasks)) != NULL){
+    pid_t tid = (pid_t)atoi(entry->d_name);
+    if(tid <= 0 or tid == self)
+      continue;
+
+    cpu_set_t mask;
+    if(sched_getaffinity(tid, sizeof(mask), &mask) != 0)
+      continue;
+    CPU_CLR(cpu, &mask);
+    if(CPU_COUNT(&mask) == 0)
+      continue;
+    if(sched_setaffinity(tid, sizeof(mask), &mask) != 0)
+      failures++;
+  }
+  closedir(tasks);
+  return failures;
+}
+
+//===========================================================================
+// Profile
+//===========================================================================
+bool ApplyRealTimeProfile(const RealTimeConfig& config){
+  bool allApplied = true;
+
+  if(config.lockMemory){
+    // Without the lock the prefaulted pages could be paged out again, and
+    // PrefaultHeap would still have turned off malloc trimming for nothing
+    if(mlockall(MCL_CURRENT | MCL_FUTURE) != 0){
+      printf("Real-time: mlockall failed (%s), memory stays pageable\n", strerror(errno));
+      allApplied = false;
+    }
+    else{
+      PrefaultStack(config.stackPrefault);
+      PrefaultHeap(config.heapPrefault);
+    }
+  }
+
+  if(config.controlCpu >= 0 and not CpuUsable(config.controlCpu)){
+    printf("Real-time: CPU %d is not online or not available to this process,"
+	   " control thread not pinned\n", config.controlCpu);
+    allApplied = false;
+  }
+  else if(config.controlCpu >= 0){
+    cpu_set_t mask;
+    CPU_ZERO(&mask);
+    CPU_SET(config.controlCpu, &mask);
+    int err = pthread_setaffinity_np(pthread_self(), sizeof(mask), &mask);
+    if(err != 0){
+      printf("Real-time: cannot pin control thread to CPU %d (%s)\n",
+	     config.controlCpu, strerror(err));
+      allApplied = false;
+    }
+    else if(MoveOtherThreadsOffCpu(config.controlCpu) != 0){
+      printf("Real-time: some ROS threads still share CPU %d\n", config.controlCpu);
+      allApplied = false;
+    }
+  }
+
+  if(config.fifoPriority > 0){
+    struct sched_param param;
+    memset(&param, 0, sizeof(param));
+    param.sched_priority = config.fifoPriority;
+    int err = pthread_setschedparam(pthread_self(), SCHED_FIFO, &param);
+    if(err != 0){
+      printf("Real-time: SCHED_FIFO %d refused (%s), staying on SCHED_OTHER\n",
+	     config.fifoPriority, strerror(err));
+      allApplied = false;
+    }
+  }
+
+  return allApplied;
+}
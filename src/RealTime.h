@@ -0,0 +1,34 @@
+#ifndef REAL_TIME_H
+#define REAL_TIME_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Opt-in real-time execution profile for the control thread. Every step is
+// best effort: when the process lacks the privilege (CAP_IPC_LOCK,
+// CAP_SYS_NICE, ...) a warning is printed and the node carries on with the
+// normal time sharing behaviour.
+struct RealTimeConfig{
+  bool lockMemory;        // mlockall and pre-fault stack and heap
+  size_t stackPrefault;   // bytes of stack to touch up front
+  size_t heapPrefault;    // bytes of heap to touch and keep
+  int controlCpu;         // CPU for the control thread, -1 leaves it alone;
+                          // must be online and in the process's affinity mask
+  int fifoPriority;       // SCHED_FIFO priority, 0 keeps SCHED_OTHER
+};
+
+void DefaultRealTimeConfig(RealTimeConfig& config);
+
+// Parses the --rt, --rt-cpu=N and --rt-fifo=P flags. Returns false if the
+// argument is not a real-time flag.
+bool ParseRealTimeOption(const char* arg, RealTimeConfig& config);
+
+// Applies the profile to the calling thread. Must be called after ROS has
+// started its own threads so they can be moved off the control CPU.
+// Returns true if every requested step succeeded.
+bool ApplyRealTimeProfile(const RealTimeConfig& config);
+
+// Monotonic clock in nanoseconds.
+uint64_t MonotonicNanoseconds();
+
+#endif
@@ -0,0 +1,216 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stddef.h>
+#include <string.h>
+#include <stdint.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "SensorLog.h"
+
+static const char kMagic[8] = {'B', 'P', 'F', 'R', 'E', 'C', '1', '\0'};
+static const size_t kWriteBufferSize = 1 << 20;
+
+static const char* recordTypeNames[SENSOR_RECORD_TYPE_COUNT] = {
+  "info", "frontProx", "rearProx", "omniFront", "omniBack", "omniRight",
+  "omniLeft", "cameraRed", "cameraBlue", "pose", "tick"
+};
+
+static inline uint32_t PaddedLength(uint32_t length){
+  return (length + 7) & ~7u;
+}
+
+const char* SensorRecordTypeName(int type){
+  if(type < 0 or type >= SENSOR_RECORD_TYPE_COUNT)
+    return "unknown";
+  return recordTypeNames[type];
+}
+
+//===========================================================================
+// SensorRecorder
+//===========================================================================
+SensorRecorder::SensorRecorder(){
+  file = NULL;
+  buffer = NULL;
+  records = 0;
+}
+
+SensorRecorder::~SensorRecorder(){
+  Close();
+}
+
+bool SensorRecorder::Open(const char* path){
+  Close();
+
+  // Always a fresh file: a second session appended to the first would
+  // restart the receive times, which the replayer takes as running
+  // backwards
+  file = fopen(path, "wb");
+  if(file == NULL){
+    printf("Could not open %s for recording\n", path);
+    return false;
+  }
+
+  buffer = (char*)malloc(kWriteBufferSize);
+  setvbuf(file, buffer, _IOFBF, kWriteBufferSize);
+
+  fwrite(kMagic, 1, sizeof(kMagic), file);
+
+  return true;
+}
+
+void SensorRecorder::Close(){
+  if(file != NULL)
+    fclose(file);
+  free(buffer);
+  file = NULL;
+  buffer = NULL;
+}
+
+bool SensorRecorder::IsOpen(){
+  return file != NULL;
+}
+
+void SensorRecorder::Write(int type, int count, uint64_t stampNs, uint64_t receiveNs,
+			   const void* payload, uint32_t length){
+  if(file == NULL)
+    return;
+
+  SensorRecordHeader header;
+  header.length = length;
+  header.type = type;
+  header.count = count;
+  header.stampNs = stampNs;
+  header.receiveNs = receiveNs;
+
+  static const char padding[8] = {0};
+  fwrite(&header, sizeof(header), 1, file);
+  if(length > 0)
+    fwrite(payload, 1, length, file);
+  fwrite(padding, 1, PaddedLength(length) - length, file);
+  records++;
+}
+
+void SensorRecorder::Info(uint64_t receiveNs, float simulationTime, int simulatorState){
+  unsigned char payload[8];
+  int32_t state = simulatorState;
+  memcpy(payload, &simulationTime, 4);
+  memcpy(payload + 4, &state, 4);
+  Write(SENSOR_RECORD_INFO, 0, 0, receiveNs, payload, sizeof(payload));
+}
+
+void SensorRecorder::Proximity(int type, uint64_t stampNs, uint64_t receiveNs){
+  Write(type, 0, stampNs, receiveNs, NULL, 0);
+}
+
+void SensorRecorder::Packet(int type, int packetCount, uint64_t stampNs, uint64_t receiveNs,
+			    const float* packetData, int packetLength){
+  Write(type, packetCount, stampNs, receiveNs, packetData, packetLength * sizeof(float));
+}
+
+void SensorRecorder::Pose(uint64_t stampNs, uint64_t receiveNs, double yaw){
+  Write(SENSOR_RECORD_POSE, 0, stampNs, receiveNs, &yaw, sizeof(yaw));
+}
+
+void SensorRecorder::Tick(uint64_t nowNs, const SensorTickRecord& tick){
+  // Field by field into a zeroed copy, so the struct's tail padding goes
+  // to disk as zeros rather than whatever was on the caller's stack
+  unsigned char payload[sizeof(SensorTickRecord)];
+  memset(payload, 0, sizeof(payload));
+  memcpy(payload + offsetof(SensorTickRecord, leftMotorSpeed), &tick.leftMotorSpeed, 4);
+  memcpy(payload + offsetof(SensorTickRecord, rightMotorSpeed), &tick.rightMotorSpeed, 4);
+  memcpy(payload + offsetof(SensorTickRecord, transSpeed), &tick.transSpeed, 4);
+  memcpy(payload + offsetof(SensorTickRecord, rotSpeed), &tick.rotSpeed, 4);
+  payload[offsetof(SensorTickRecord, servoOpen)] = tick.servoOpen;
+  memcpy(payload + offsetof(SensorTickRecord, stimuli), tick.stimuli, sizeof(tick.stimuli));
+  Write(SENSOR_RECORD_TICK, 0, 0, nowNs, payload, sizeof(payload));
+}
+
+unsigned long SensorRecorder::GetRecordCount(){
+  return records;
+}
+
+//===========================================================================
+// SensorLogReader
+//===========================================================================
+SensorLogReader::SensorLogReader(){
+  data = NULL;
+  size = 0;
+  offset = 0;
+}
+
+SensorLogReader::~SensorLogReader(){
+  Close();
+}
+
+bool SensorLogReader::Open(const char* path){
+  Close();
+
+  int fd = open(path, O_RDONLY);
+  if(fd < 0){
+    printf("Could not open %s\n", path);
+    return false;
+  }
+
+  struct stat info;
+  if(fstat(fd, &info) != 0 or info.st_size < (off_t)sizeof(kMagic)){
+    printf("%s is not a sensor recording\n", path);
+    close(fd);
+    return false;
+  }
+
+  void* mapping = mmap(NULL, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if(mapping == MAP_FAILED){
+    printf("Could not map %s\n", path);
+    return false;
+  }
+
+  data = (const unsigned char*)mapping;
+  size = info.st_size;
+  if(memcmp(data, kMagic, sizeof(kMagic)) != 0){
+    printf("%s is not a sensor recording\n", path);
+    Close();
+    return false;
+  }
+
+  // Records are read front to back
+  madvise(mapping, size, MADV_SEQUENTIAL);
+  Rewind();
+  return true;
+}
+
+void SensorLogReader::Close(){
+  if(data != NULL)
+    munmap((void*)data, size);
+  data = NULL;
+  size = 0;
+  offset = 0;
+}
+
+void SensorLogReader::Rewind(){
+  offset = sizeof(kMagic);
+}
+
+bool SensorLogReader::Next(SensorRecordHeader& header, const unsigned char*& payload){
+  if(data == NULL or offset + sizeof(header) > size)
+    return false;
+
+  memcpy(&header, data + offset, sizeof(header));
+  size_t end = offset + sizeof(header) + PaddedLength(header.length);
+  if(end > size){
+    printf("Truncated %s record at offset %lu\n", SensorRecordTypeName(header.type),
+	   (unsigned long)offset);
+    return false;
+  }
+
+  payload = data + offset + sizeof(header);
+  offset = end;
+  return true;
+}
+
+size_t SensorLogReader::GetSize(){
+  return size;
+}
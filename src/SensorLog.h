@@ -0,0 +1,124 @@
+#ifndef SENSOR_LOG_H
+#define SENSOR_LOG_H
+
+#include <stdio.h>
+#include <stdint.h>
+
+// Sequential recording of everything the controller is fed, so a live run
+// can be replayed offline through BotController. Layout, little endian:
+//
+//   char[8]   magic "BPFREC1\0"
+//   records, each:
+//     uint32    payload length in bytes
+//     uint16    record type (SensorRecordType)
+//     uint16    type specific count (packet sizes for vision data)
+//     uint64    sensor header stamp, ROS time in ns
+//     uint64    receive time, monotonic clock in ns
+//     payload, zero padded to a multiple of 8 bytes
+//
+// Payloads:
+//   INFO          float simulationTime, int32 simulatorState
+//   FRONT/REAR    none, a record means the sensor fired
+//   OMNI_*, CAM_* float packetData[length / 4]
+//   POSE          double yaw
+//   TICK          float left, right, trans, rot, uint8 servoOpen, stimuli[8],
+//                 3 zero bytes of struct padding, 28 bytes in all
+//                 (recordings made before closingFast have 7 stimuli)
+//
+// A TICK record marks where the control loop ran and holds what it put out,
+// which the replayer compares its own outputs against.
+enum SensorRecordType{
+  SENSOR_RECORD_INFO = 0,
+  SENSOR_RECORD_FRONT_PROX,
+  SENSOR_RECORD_REAR_PROX,
+  SENSOR_RECORD_OMNI_FRONT,   // OMNI_FRONT..OMNI_LEFT follow the OmniSegment order
+  SENSOR_RECORD_OMNI_BACK,
+  SENSOR_RECORD_OMNI_RIGHT,
+  SENSOR_RECORD_OMNI_LEFT,
+  SENSOR_RECORD_CAMERA_RED,
+  SENSOR_RECORD_CAMERA_BLUE,
+  SENSOR_RECORD_POSE,
+  SENSOR_RECORD_TICK,
+  SENSOR_RECORD_TYPE_COUNT
+};
+
+struct SensorRecordHeader{
+  uint32_t length;
+  uint16_t type;
+  uint16_t count;
+  uint64_t stampNs;
+  uint64_t receiveNs;
+};
+
+struct SensorTickRecord{
+  float leftMotorSpeed;
+  float rightMotorSpeed;
+  float transSpeed;
+  float rotSpeed;
+  uint8_t servoOpen;
+  uint8_t stimuli[8];
+};
+
+const char* SensorRecordTypeName(int type);
+
+// Writes records through a large stdio buffer; nothing is allocated once
+// the file is open, so recording is safe under --alloc-strict. Every call is
+// a no-op while no file is open.
+class SensorRecorder{
+
+ public:
+
+  SensorRecorder();
+  ~SensorRecorder();
+
+  // Starts a new recording, replacing any file already at path
+  bool Open(const char* path);
+  void Close();
+  bool IsOpen();
+
+  void Write(int type, int count, uint64_t stampNs, uint64_t receiveNs,
+	     const void* payload, uint32_t length);
+
+  void Info(uint64_t receiveNs, float simulationTime, int simulatorState);
+  void Proximity(int type, uint64_t stampNs, uint64_t receiveNs);
+  void Packet(int type, int packetCount, uint64_t stampNs, uint64_t receiveNs,
+	      const float* packetData, int packetLength);
+  void Pose(uint64_t stampNs, uint64_t receiveNs, double yaw);
+  void Tick(uint64_t nowNs, const SensorTickRecord& tick);
+
+  unsigned long GetRecordCount();
+
+ private:
+
+  FILE* file;
+  char* buffer;
+  unsigned long records;
+};
+
+// Maps a recording read only and walks its records in order
+class SensorLogReader{
+
+ public:
+
+  SensorLogReader();
+  ~SensorLogReader();
+
+  bool Open(const char* path);
+  void Close();
+
+  // Back to the first record
+  void Rewind();
+
+  // Fills header and points payload into the mapping. Returns false at the
+  // end of the file or on a truncated record.
+  bool Next(SensorRecordHeader& header, const unsigned char*& payload);
+
+  size_t GetSize();
+
+ private:
+
+  const unsigned char* data;
+  size_t size;
+  size_t offset;
+};
+#endif
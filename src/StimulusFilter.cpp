@@ -0,0 +1,87 @@
+#include "StimulusFilter.h"
+
+StimulusFilter::StimulusFilter(){
+  for(int i = 0; i < kNumStimuli; i++){
+    riseTime[i] = 0.;
+    fallTime[i] = 0.;
+  }
+  Reset();
+};
+
+void StimulusFilter::Reset(){
+  raw = Stimuli();
+  filtered = Stimuli();
+  first = true;
+  for(int i = 0; i < kNumStimuli; i++){
+    rawSince[i] = 0.;
+    rawChanges[i] = 0;
+    filteredChanges[i] = 0;
+  }
+};
+
+void StimulusFilter::SetDwell(int bit, float riseTime, float fallTime){
+  this->riseTime[bit] = riseTime;
+  this->fallTime[bit] = fallTime;
+};
+
+Stimuli StimulusFilter::Update(Stimuli raw, float time){
+
+  // Nothing to debounce against on the first tick
+  if(first){
+    first = false;
+    this->raw = raw;
+    filtered = raw;
+    for(int i = 0; i < kNumStimuli; i++)
+      rawSince[i] = time;
+    return filtered;
+  }
+
+  for(int i = 0; i < kNumStimuli; i++){
+    bool value = raw.Get(i);
+    if(value != this->raw.Get(i)){
+      rawSince[i] = time;
+      rawChanges[i]++;
+    }
+    if(value == filtered.Get(i))
+      continue;
+
+    float dwell = value ? riseTime[i] : fallTime[i];
+    if(time - rawSince[i] >= dwell){
+      filtered.Set(i, value);
+      filteredChanges[i]++;
+    }
+  }
+  this->raw = raw;
+
+  return filtered;
+};
+
+Stimuli StimulusFilter::GetRaw(){
+  return raw;
+};
+
+Stimuli StimulusFilter::GetFiltered(){
+  return filtered;
+};
+
+long StimulusFilter::GetRawChanges(int bit){
+  return rawChanges[bit];
+};
+
+long StimulusFilter::GetFilteredChanges(int bit){
+  return filteredChanges[bit];
+};
+
+long StimulusFilter::GetRawChanges(){
+  long changes = 0;
+  for(int i = 0; i < kNumStimuli; i++)
+    changes += rawChanges[i];
+  return changes;
+};
+
+long StimulusFilter::GetFilteredChanges(){
+  long changes = 0;
+  for(int i = 0; i < kNumStimuli; i++)
+    changes += filteredChanges[i];
+  return changes;
+};
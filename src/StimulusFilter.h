@@ -0,0 +1,54 @@
+#ifndef STIMULUS_FILTER_H
+#define STIMULUS_FILTER_H
+
+#include "FSM/SensorSnapshot.h"
+
+// Debounces the raw stimuli before the state machine sees them, so a flag
+// that flickers for a frame or two does not bounce the FSM between states
+// at camera rate.
+//
+// Each stimulus has a minimum dwell for each direction: the filtered bit
+// only rises once the raw bit has been set for riseTime seconds, and only
+// falls once it has been clear for fallTime. A dwell of 0 passes that edge
+// straight through, which is what the one tick proximity hits need.
+//
+// Changes of every bit are counted before and after filtering, so the
+// batch tools can report how much thrashing the filter removed.
+class StimulusFilter{
+
+ public:
+
+  StimulusFilter();
+
+  void Reset();
+
+  void SetDwell(int bit, float riseTime, float fallTime);
+
+  // Filters one tick's raw stimuli, taken at time seconds
+  Stimuli Update(Stimuli raw, float time);
+
+  Stimuli GetRaw();
+  Stimuli GetFiltered();
+
+  // Changes of one bit so far, before and after filtering; summed over all
+  // of them without an argument
+  long GetRawChanges(int bit);
+  long GetFilteredChanges(int bit);
+  long GetRawChanges();
+  long GetFilteredChanges();
+
+ private:
+
+  float riseTime[kNumStimuli];
+  float fallTime[kNumStimuli];
+
+  Stimuli raw;
+  Stimuli filtered;
+  float rawSince[kNumStimuli];    // time the raw bit took its current value
+  bool first;
+
+  long rawChanges[kNumStimuli];
+  long filteredChanges[kNumStimuli];
+};
+
+#endif
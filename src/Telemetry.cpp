@@ -0,0 +1,30 @@
+#include <stdio.h>
+#include <string>
+
+#include "Telemetry.h"
+#include "BotController.h"
+
+int FormatTelemetry(char* buffer, int bufferSize, BotController& controller){
+  std::string behaviour = controller.GetStateManager()->GetCurrentStateName();
+  int n = snprintf(buffer, bufferSize,
+		   "behaviour = %s\n"
+		   "frontProxSensor = %d\n"
+		   "rearProxSensor = %d\n"
+		   "friendLeft = %d\n"
+		   "friendRight = %d\n"
+		   "friendAhead = %d\n"
+		   "friendBehind = %d\n"
+		   "aligned = %d\n"
+		   "closingFast = %d\n"
+		   "transSpeed = %g\n"
+		   "rotSpeed = %g\n",
+		   behaviour.c_str(),
+		   controller.GetStimulus(0), controller.GetStimulus(1),
+		   controller.GetStimulus(2), controller.GetStimulus(3),
+		   controller.GetStimulus(4), controller.GetStimulus(5),
+		   controller.GetStimulus(6), controller.GetStimulus(7),
+		   controller.GetTransSpeed(), controller.GetRotSpeed());
+  if(n >= bufferSize)
+    n = bufferSize - 1;
+  return n;
+}
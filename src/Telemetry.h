@@ -0,0 +1,11 @@
+#ifndef TELEMETRY_H
+#define TELEMETRY_H
+
+#include "BotController.h"
+
+// The per tick debugging text shown in V-REP's auxiliary console: current
+// behaviour, stimuli and commanded speeds, one "name = value" per line.
+// Written into the caller's buffer, truncated to fit; returns the length.
+int FormatTelemetry(char* buffer, int bufferSize, BotController& controller);
+
+#endif
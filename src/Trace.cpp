@@ -0,0 +1,130 @@
+#ifdef BOT_TRACING
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/syscall.h>
+
+#include "Trace.h"
+
+struct TraceEvent{
+  uint64_t timestamp;     // ns, monotonic
+  const char* name;
+  char phase;             // 'B', 'E' or 'i'
+  char from[24];          // state names for instant events
+  char to[24];
+};
+
+// 64k events per thread, roughly 4.5MB each.
+static const int kTraceCapacity = 1 << 16;
+
+struct TraceBuffer{
+  TraceEvent events[kTraceCapacity];
+  uint64_t written;
+  long tid;
+  TraceBuffer* next;
+};
+
+static __thread TraceBuffer* threadBuffer = NULL;
+
+// Buffers are only ever added, under the lock, so writers never contend
+// after their first event.
+static TraceBuffer* allBuffers = NULL;
+static pthread_mutex_t buffersLock = PTHREAD_MUTEX_INITIALIZER;
+
+static uint64_t TraceClock(){
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+static TraceBuffer* GetThreadBuffer(){
+  if(threadBuffer == NULL){
+    TraceBuffer* buffer = (TraceBuffer*)calloc(1, sizeof(TraceBuffer));
+    if(buffer == NULL)
+      abort();
+    buffer->tid = (long)syscall(SYS_gettid);
+
+    pthread_mutex_lock(&buffersLock);
+    buffer->next = allBuffers;
+    allBuffers = buffer;
+    pthread_mutex_unlock(&buffersLock);
+
+    threadBuffer = buffer;
+  }
+  return threadBuffer;
+}
+
+static TraceEvent* NextEvent(){
+  TraceBuffer* buffer = GetThreadBuffer();
+  TraceEvent* event = &buffer->events[buffer->written & (kTraceCapacity - 1)];
+  buffer->written++;
+  return event;
+}
+
+void TraceBegin(const char* name){
+  TraceEvent* event = NextEvent();
+  event->timestamp = TraceClock();
+  event->name = name;
+  event->phase = 'B';
+}
+
+void TraceEnd(const char* name){
+  TraceEvent* event = NextEvent();
+  event->timestamp = TraceClock();
+  event->name = name;
+  event->phase = 'E';
+}
+
+void TraceStateChange(const char* from, const char* to){
+  TraceEvent* event = NextEvent();
+  event->timestamp = TraceClock();
+  event->name = "StateChange";
+  event->phase = 'i';
+  strncpy(event->from, from, sizeof(event->from) - 1);
+  event->from[sizeof(event->from) - 1] = '\0';
+  strncpy(event->to, to, sizeof(event->to) - 1);
+  event->to[sizeof(event->to) - 1] = '\0';
+}
+
+bool TraceWriteChromeJson(const char* path){
+  FILE* file = fopen(path, "w");
+  if(file == NULL){
+    printf("Trace: cannot open %s\n", path);
+    return false;
+  }
+
+  long pid = (long)getpid();
+  bool first = true;
+
+  fprintf(file, "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n");
+
+  pthread_mutex_lock(&buffersLock);
+  for(TraceBuffer* buffer = allBuffers; buffer != NULL; buffer = buffer->next){
+    uint64_t count = buffer->written;
+    uint64_t start = count > (uint64_t)kTraceCapacity ? count - kTraceCapacity : 0;
+
+    for(uint64_t i = start; i < count; i++){
+      const TraceEvent& event = buffer->events[i & (kTraceCapacity - 1)];
+      fprintf(file, "%s{\"name\":\"%s\",\"ph\":\"%c\",\"ts\":%.3f,\"pid\":%ld,\"tid\":%ld",
+	      first ? "" : ",\n", event.name, event.phase,
+	      event.timestamp / 1000., pid, buffer->tid);
+      if(event.phase == 'i')
+	fprintf(file, ",\"s\":\"t\",\"args\":{\"from\":\"%s\",\"to\":\"%s\"}",
+		event.from, event.to);
+      fprintf(file, "}");
+      first = false;
+    }
+  }
+  pthread_mutex_unlock(&buffersLock);
+
+  fprintf(file, "\n]}\n");
+  fclose(file);
+  return true;
+}
+
+#endif
@@ -0,0 +1,48 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+// Timeline tracing of the control loop, written out as Chrome trace JSON
+// (chrome://tracing or ui.perfetto.dev).
+//
+// Only built in with BOT_TRACING. Each thread records into its own fixed
+// size ring buffer, so recording is a clock read and a few stores; the
+// oldest events are overwritten once a buffer is full. Event names must be
+// string literals. Without BOT_TRACING every macro expands to nothing and
+// its arguments are not evaluated.
+
+#ifdef BOT_TRACING
+
+void TraceBegin(const char* name);
+void TraceEnd(const char* name);
+void TraceStateChange(const char* from, const char* to);
+
+// Writes every thread's buffer to a Chrome trace file.
+bool TraceWriteChromeJson(const char* path);
+
+class TraceScope{
+ public:
+  TraceScope(const char* name): name(name){ TraceBegin(name); };
+  ~TraceScope(){ TraceEnd(name); };
+ private:
+  const char* name;
+};
+
+#define TRACE_CAT2(a, b) a##b
+#define TRACE_CAT(a, b) TRACE_CAT2(a, b)
+#define TRACE_BEGIN(name) TraceBegin(name)
+#define TRACE_END(name) TraceEnd(name)
+#define TRACE_SCOPE(name) TraceScope TRACE_CAT(traceScope_, __LINE__)(name)
+#define TRACE_STATE_CHANGE(from, to) TraceStateChange(from, to)
+
+#else
+
+inline bool TraceWriteChromeJson(const char* /* path */){ return false; };
+
+#define TRACE_BEGIN(name)
+#define TRACE_END(name)
+#define TRACE_SCOPE(name)
+#define TRACE_STATE_CHANGE(from, to)
+
+#endif
+
+#endif
@@ -0,0 +1,228 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <string>
+#include <vector>
+
+#include "Benchmark.h"
+
+using namespace std;
+
+struct RegisteredBenchmark{
+  string name;
+  BenchmarkFunction function;
+  long arg;
+};
+
+struct BenchmarkResult{
+  string name;
+  long iterations;
+  double realNs;
+  double cpuNs;
+  double itemsPerSecond;
+};
+
+static const long kMaxIterations = 1000000000;
+
+static vector<RegisteredBenchmark>& Registry(){
+  static vector<RegisteredBenchmark> registry;
+  return registry;
+}
+
+static uint64_t ClockNanoseconds(clockid_t clock){
+  struct timespec ts;
+  clock_gettime(clock, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+//===========================================================================
+// BenchmarkState
+//===========================================================================
+BenchmarkState::BenchmarkState(long iterations, long arg){
+  this->iterations = iterations;
+  this->arg = arg;
+  remaining = iterations;
+  started = false;
+  itemsPerIteration = 0.;
+  realStart = 0;
+  cpuStart = 0;
+  realTotal = 0;
+  cpuTotal = 0;
+}
+
+bool BenchmarkState::KeepRunning(){
+  if(not started){
+    started = true;
+    ResumeTiming();
+  }
+  if(remaining-- > 0)
+    return true;
+
+  PauseTiming();
+  return false;
+}
+
+void BenchmarkState::PauseTiming(){
+  realTotal += ClockNanoseconds(CLOCK_MONOTONIC) - realStart;
+  cpuTotal += ClockNanoseconds(CLOCK_THREAD_CPUTIME_ID) - cpuStart;
+}
+
+void BenchmarkState::ResumeTiming(){
+  realStart = ClockNanoseconds(CLOCK_MONOTONIC);
+  cpuStart = ClockNanoseconds(CLOCK_THREAD_CPUTIME_ID);
+}
+
+long BenchmarkState::GetArg(){
+  return arg;
+}
+
+long BenchmarkState::GetIterations(){
+  return iterations;
+}
+
+void BenchmarkState::SetItemsPerIteration(double items){
+  itemsPerIteration = items;
+}
+
+double BenchmarkState::GetItemsPerIteration(){
+  return itemsPerIteration;
+}
+
+double BenchmarkState::GetRealSeconds(){
+  return realTotal * 1e-9;
+}
+
+double BenchmarkState::GetCpuSeconds(){
+  return cpuTotal * 1e-9;
+}
+
+//===========================================================================
+// Running and reporting
+//===========================================================================
+void RegisterBenchmark(const string& name, BenchmarkFunction function, long arg,
+		       const char* argName){
+  RegisteredBenchmark benchmark;
+  benchmark.name = name;
+  benchmark.function = function;
+  benchmark.arg = arg;
+  if(argName != NULL){
+    benchmark.name += "/";
+    benchmark.name += argName;
+  }
+  else if(arg >= 0){
+    char suffix[32];
+    snprintf(suffix, sizeof(suffix), "/%ld", arg);
+    benchmark.name += suffix;
+  }
+  Registry().push_back(benchmark);
+}
+
+// Grows the iteration count, like Google Benchmark, until one run is long
+// enough to time reliably
+static BenchmarkResult Run(const RegisteredBenchmark& benchmark, double minTime){
+  long iterations = 1;
+  while(true){
+    BenchmarkState state(iterations, benchmark.arg);
+    benchmark.function(state);
+    double seconds = state.GetRealSeconds();
+
+    if(seconds >= minTime or iterations >= kMaxIterations){
+      BenchmarkResult result;
+      result.name = benchmark.name;
+      result.iterations = iterations;
+      result.realNs = seconds * 1e9 / iterations;
+      result.cpuNs = state.GetCpuSeconds() * 1e9 / iterations;
+      result.itemsPerSecond = seconds > 0. ?
+	state.GetItemsPerIteration() * iterations / seconds : 0.;
+      return result;
+    }
+
+    // Aim 40% past the target, growing at most tenfold per round
+    double scale = seconds > 0. ? 1.4 * minTime / seconds : 10.;
+    if(scale > 10.)
+      scale = 10.;
+    long next = iterations * scale;
+    iterations = next > iterations ? next : iterations + 1;
+    if(iterations > kMaxIterations)
+      iterations = kMaxIterations;
+  }
+}
+
+static void WriteJson(const char* path, const vector<BenchmarkResult>& results,
+		      const char* program){
+  FILE* file = fopen(path, "w");
+  if(file == NULL){
+    printf("Could not write %s\n", path);
+    return;
+  }
+
+  char host[256] = "";
+  gethostname(host, sizeof(host) - 1);
+  time_t now = time(NULL);
+  char date[64];
+  strftime(date, sizeof(date), "%Y-%m-%dT%H:%M:%S", localtime(&now));
+
+  fprintf(file, "{\n  \"context\": {\n");
+  fprintf(file, "    \"date\": \"%s\",\n", date);
+  fprintf(file, "    \"host_name\": \"%s\",\n", host);
+  fprintf(file, "    \"executable\": \"%s\",\n", program);
+  fprintf(file, "    \"num_cpus\": %ld\n", sysconf(_SC_NPROCESSORS_ONLN));
+  fprintf(file, "  },\n  \"benchmarks\": [\n");
+  int count = results.size();
+  for(int i = 0; i < count; i++){
+    const BenchmarkResult& result = results[i];
+    fprintf(file, "    {\n      \"name\": \"%s\",\n", result.name.c_str());
+    fprintf(file, "      \"run_type\": \"iteration\",\n");
+    fprintf(file, "      \"iterations\": %ld,\n", result.iterations);
+    fprintf(file, "      \"real_time\": %.3f,\n", result.realNs);
+    fprintf(file, "      \"cpu_time\": %.3f,\n", result.cpuNs);
+    if(result.itemsPerSecond > 0.)
+      fprintf(file, "      \"items_per_second\": %.1f,\n", result.itemsPerSecond);
+    fprintf(file, "      \"time_unit\": \"ns\"\n    }%s\n", i + 1 < count ? "," : "");
+  }
+  fprintf(file, "  ]\n}\n");
+  fclose(file);
+}
+
+int RunBenchmarks(int argc, char* argv[]){
+  const char* filter = NULL;
+  const char* jsonPath = NULL;
+  double minTime = 0.2;
+
+  for(int i = 1; i < argc; i++){
+    if(strncmp(argv[i], "--filter=", 9) == 0)
+      filter = argv[i] + 9;
+    else if(strncmp(argv[i], "--min-time=", 11) == 0)
+      minTime = atof(argv[i] + 11);
+    else if(strncmp(argv[i], "--json=", 7) == 0)
+      jsonPath = argv[i] + 7;
+    else{
+      printf("Unknown option %s\n", argv[i]);
+      return 1;
+    }
+  }
+
+  vector<BenchmarkResult> results;
+  const vector<RegisteredBenchmark>& registry = Registry();
+
+  printf("%-40s %14s %14s %12s\n", "Benchmark", "Time (ns)", "CPU (ns)", "Iterations");
+  for(size_t i = 0; i < registry.size(); i++){
+    if(filter != NULL and registry[i].name.find(filter) == string::npos)
+      continue;
+
+    BenchmarkResult result = Run(registry[i], minTime);
+    printf("%-40s %14.1f %14.1f %12ld", result.name.c_str(), result.realNs, result.cpuNs,
+	   result.iterations);
+    if(result.itemsPerSecond > 0.)
+      printf("  %.3gM items/s", result.itemsPerSecond * 1e-6);
+    printf("\n");
+    fflush(stdout);
+    results.push_back(result);
+  }
+
+  if(jsonPath != NULL)
+    WriteJson(jsonPath, results, argv[0]);
+  return 0;
+}
@@ -0,0 +1,79 @@
+#ifndef BENCHMARK_H
+#define BENCHMARK_H
+
+#include <stdint.h>
+#include <string>
+
+using namespace std;
+
+// A small benchmark harness in the style of Google Benchmark, without the
+// dependency. A benchmark is a function taking a BenchmarkState and timing
+// everything inside its KeepRunning loop:
+//
+//   static void BM_Something(BenchmarkState& state){
+//     ... set up ...
+//     while(state.KeepRunning())
+//       BenchmarkKeep(Something(state.GetArg()));
+//   }
+//   RegisterBenchmark("BM_Something", BM_Something, 8);
+//
+// The iteration count grows until a run lasts the minimum time, then the
+// per iteration wall and CPU times are reported. RunBenchmarks writes a
+// table to stdout and, with --json=file, the same results in Google
+// Benchmark's JSON layout so existing comparison scripts can read them.
+class BenchmarkState{
+
+ public:
+
+  BenchmarkState(long iterations, long arg);
+
+  bool KeepRunning();
+
+  // Excludes set up done inside the loop from the timing
+  void PauseTiming();
+  void ResumeTiming();
+
+  long GetArg();
+  long GetIterations();
+
+  // Items processed per iteration, reported as items_per_second
+  void SetItemsPerIteration(double items);
+  double GetItemsPerIteration();
+
+  double GetRealSeconds();
+  double GetCpuSeconds();
+
+ private:
+
+  long iterations;
+  long remaining;
+  long arg;
+  bool started;
+  double itemsPerIteration;
+
+  uint64_t realStart;
+  uint64_t cpuStart;
+  uint64_t realTotal;
+  uint64_t cpuTotal;
+};
+
+typedef void (*BenchmarkFunction)(BenchmarkState& state);
+
+// arg < 0 registers a benchmark without an argument. Otherwise the name is
+// reported as name/arg, or name/argName when one is given.
+void RegisterBenchmark(const string& name, BenchmarkFunction function, long arg = -1,
+		       const char* argName = NULL);
+
+// Options: --filter=substring --min-time=seconds --json=file
+int RunBenchmarks(int argc, char* argv[]);
+
+// Stops the compiler from optimising a result away
+template <class T>
+inline void BenchmarkKeep(const T& value){
+  asm volatile("" : : "r,m"(value) : "memory");
+}
+
+inline void BenchmarkClobber(){
+  asm volatile("" : : : "memory");
+}
+#endif
@@ -0,0 +1,394 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <string>
+#include <vector>
+
+#include "Benchmark.h"
+#include "../BotController.h"
+#include "../Telemetry.h"
+#include "../FormationHeading.h"
+#include "../BlobTracker.h"
+#include "../BlobDetector.h"
+#include "../DriveOutput.h"
+#include "../FSM/FSM.h"
+
+#ifdef BOT_BENCH_ROS
+#include <ros/serialization.h>
+#include "vrep_common/JointSetStateData.h"
+#endif
+
+using namespace std;
+
+//===========================================================================
+// Microbenchmarks of the control loop's hot paths
+//
+//   botBenchmarks [--filter=substring] [--min-time=seconds] [--json=file]
+//
+//   BM_OmniPacket/N        decoding one omni segment packet with N blobs
+//   BM_DecodeAndFuse/N     four segment packets, N blobs in all, then fusion
+//   BM_FormationHeading/N  formation heading error over N fused blobs
+//   BM_BlobTracker/N       associating N slowly moving blobs with their tracks
+//   BM_ThresholdRow        colour thresholding a 128 pixel image row (SSE2)
+//   BM_ThresholdRowScalar  the same with the scalar reference
+//   BM_DetectBlobs/S/N/L   raw SxS omni image with N markers to packet,
+//                          full resolution (L0) or with a 2x/4x coarse
+//                          pass first (L1, L2)
+//   BM_SetCurrentState/S   creating state S (the baseline for the next one)
+//   BM_UpdateBehaviour/S   transition out of state S, cycling through all
+//                          256 stimulus masks
+//   BM_ExecuteBehaviour/S  running state S
+//   BM_WheelSpeeds         controller ExecuteBehaviour, FSM plus wheel maths
+//   BM_DriveOutput/M       the output stage alone on a cycle of state
+//                          changes, with no limits, wheel speed
+//                          saturation, acceleration limits or all three
+//                          limits (M = none, speed, accel, all)
+//   BM_WheelMessage        filling and serialising the wheel command
+//                          (BOT_BENCH_ROS builds only)
+//   BM_Telemetry           formatting the console text
+//
+// --json writes Google Benchmark compatible results for regression tracking.
+//===========================================================================
+
+static const char* kStateNames[] = {
+  "Align", "Cruise", "CatchUp", "Halt", "ImpulseSpeed", "Evade"
+};
+static const int kNumStates = sizeof(kStateNames) / sizeof(kStateNames[0]);
+static const int kNumStimulusMasks = 1 << kNumStimuli;
+
+static const int kDatumPerBlob = 6;
+
+// A packet in the blob filter's layout with numberOfBlobs blobs spread
+// across the segment's field of view
+static void BuildPacket(vector<float>& packet, int numberOfBlobs){
+  packet.assign(3 + numberOfBlobs*kDatumPerBlob, 0.);
+  packet[kOmniBlobCountIndex] = numberOfBlobs;
+  packet[kOmniDatumPerBlobIndex] = kDatumPerBlob;
+  for(int i = 0; i < numberOfBlobs; i++){
+    float bearing = -M_PI/4. + (i + 0.5) * (M_PI/2.) / numberOfBlobs;
+    packet[i*kDatumPerBlob + kOmniBlobXOffset] = 0.25 * cos(bearing);
+    packet[i*kDatumPerBlob + kOmniBlobYOffset] = 0.25 * sin(bearing);
+    packet[i*kDatumPerBlob + kOmniBlobWidthOffset] = 0.1;
+    packet[i*kDatumPerBlob + kOmniBlobHeightOffset] = 0.1;
+  }
+}
+
+//===========================================================================
+// Decode
+//===========================================================================
+static void BM_OmniPacket(BenchmarkState& state){
+  BotController controller;
+  vector<float> packet;
+  BuildPacket(packet, state.GetArg());
+
+  while(state.KeepRunning()){
+    controller.OmniPacket(OMNI_FRONT, &packet[0], packet.size());
+    BenchmarkClobber();
+  }
+  state.SetItemsPerIteration(state.GetArg());
+}
+
+static void BM_DecodeAndFuse(BenchmarkState& state){
+  BotController controller;
+  vector<float> packets[OMNI_SEGMENT_COUNT];
+  for(int s = 0; s < OMNI_SEGMENT_COUNT; s++)
+    BuildPacket(packets[s], (state.GetArg() + s) / OMNI_SEGMENT_COUNT);
+
+  while(state.KeepRunning()){
+    for(int s = 0; s < OMNI_SEGMENT_COUNT; s++)
+      controller.OmniPacket(s, &packets[s][0], packets[s].size());
+    controller.FuseSensors();
+    BenchmarkKeep(controller.GetBlobs().size());
+  }
+  state.SetItemsPerIteration(state.GetArg());
+}
+
+static void BM_FormationHeading(BenchmarkState& state){
+  int count = state.GetArg();
+  vector<blobClass> blobs(count);
+  vector<blobClass*> fused;
+  for(int i = 0; i < count; i++){
+    blobs[i].blobBearing = -M_PI + (i + 0.3) * 2.*M_PI / count;
+    blobs[i].blobArea = 0.01;
+    blobs[i].blobCos = cos(blobs[i].blobBearing);
+    blobs[i].blobSin = sin(blobs[i].blobBearing);
+    fused.push_back(&blobs[i]);
+  }
+
+  while(state.KeepRunning())
+    BenchmarkKeep(FormationHeadingError(fused, 0.1));
+  state.SetItemsPerIteration(state.GetArg());
+}
+
+static void BM_BlobTracker(BenchmarkState& state){
+  int count = state.GetArg();
+  vector<blobClass> blobs(count);
+  vector<blobClass*> fused;
+  for(int i = 0; i < count; i++){
+    blobs[i].blobBearing = -M_PI + (i + 0.3) * 2.*M_PI / count;
+    blobs[i].blobArea = 0.01;
+    fused.push_back(&blobs[i]);
+  }
+
+  BlobTracker tracker;
+  float time = 0.;
+  int frame = 0;
+  while(state.KeepRunning()){
+    // Every blob jitters a little each frame, so the tracks keep matching
+    float jitter = (frame++ & 1) ? 0.002 : -0.002;
+    for(int i = 0; i < count; i++)
+      blobs[i].blobBearing += (i & 1) ? jitter : -jitter;
+    time += 0.05;
+    tracker.Update(fused, time);
+    BenchmarkKeep(tracker.GetTrackCount());
+  }
+  state.SetItemsPerIteration(state.GetArg());
+}
+
+//===========================================================================
+// Raw image blob detection
+//===========================================================================
+static const int kImageSize = 128;
+
+// Background noise below the marker colour with numberOfBlobs red discs
+// on a grid, radius 4 in a 128 pixel image and scaled with the size
+static void BuildImage(vector<uint8_t>& image, int size, int numberOfBlobs){
+  image.resize(size*size*3);
+  for(size_t i = 0; i < image.size(); i++)
+    image[i] = (i * 37) & 0x7f;
+
+  int radius = size / 32;
+  int perRow = 1;
+  while(perRow*perRow < numberOfBlobs)
+    perRow++;
+  int spacing = size / (perRow + 1);
+  for(int b = 0; b < numberOfBlobs; b++){
+    int cx = spacing * (b % perRow + 1);
+    int cy = spacing * (b / perRow + 1);
+    for(int y = cy - radius; y <= cy + radius; y++)
+      for(int x = cx - radius; x <= cx + radius; x++)
+	if((x - cx)*(x - cx) + (y - cy)*(y - cy) <= radius*radius){
+	  uint8_t* pixel = &image[3*(y*size + x)];
+	  pixel[0] = 220;
+	  pixel[1] = 30;
+	  pixel[2] = 30;
+	}
+  }
+}
+
+static void BM_ThresholdRow(BenchmarkState& state){
+  vector<uint8_t> image;
+  BuildImage(image, kImageSize, 0);
+  BlobDetectorConfig config;
+  DefaultBlobDetectorConfig(config);
+  ThresholdPattern pattern;
+  MakeThresholdPattern(config, pattern);
+  uint8_t mask[kImageSize];
+
+  while(state.KeepRunning()){
+    ThresholdRow(&image[0], kImageSize, pattern, mask);
+    BenchmarkClobber();
+  }
+  state.SetItemsPerIteration(kImageSize);
+}
+
+static void BM_ThresholdRowScalar(BenchmarkState& state){
+  vector<uint8_t> image;
+  BuildImage(image, kImageSize, 0);
+  BlobDetectorConfig config;
+  DefaultBlobDetectorConfig(config);
+  ThresholdPattern pattern;
+  MakeThresholdPattern(config, pattern);
+  uint8_t mask[kImageSize];
+
+  while(state.KeepRunning()){
+    ThresholdRowScalar(&image[0], kImageSize, pattern, mask);
+    BenchmarkClobber();
+  }
+  state.SetItemsPerIteration(kImageSize);
+}
+
+// The argument packs the case as level*1000000 + size*1000 + markers
+static void BM_DetectBlobs(BenchmarkState& state){
+  int level = state.GetArg() / 1000000;
+  int size = state.GetArg() / 1000 % 1000;
+  int numberOfBlobs = state.GetArg() % 1000;
+
+  vector<uint8_t> image;
+  BuildImage(image, size, numberOfBlobs);
+  BlobDetectorConfig config;
+  DefaultBlobDetectorConfig(config);
+  config.pyramidLevels = level;
+  BlobDetector detector(config);
+  vector<float> packet;
+
+  while(state.KeepRunning())
+    BenchmarkKeep(detector.Detect(&image[0], size, size, 3*size, packet));
+  state.SetItemsPerIteration(size*size);
+}
+
+//===========================================================================
+// State machine
+//===========================================================================
+static void BM_SetCurrentState(BenchmarkState& state){
+  StateManager fsm;
+  string name = kStateNames[state.GetArg()];
+
+  while(state.KeepRunning())
+    fsm.SetCurrentState(name);
+}
+
+static void BM_UpdateBehaviour(BenchmarkState& state){
+  StateManager fsm;
+  string name = kStateNames[state.GetArg()];
+  SensorSnapshot sensors;
+
+  int mask = 0;
+  while(state.KeepRunning()){
+    fsm.SetCurrentState(name);
+    sensors.stimuli = Stimuli(mask);
+    fsm.UpdateBehaviour(sensors);
+    mask = (mask + 1) & (kNumStimulusMasks - 1);
+  }
+}
+
+static void BM_ExecuteBehaviour(BenchmarkState& state){
+  StateManager fsm;
+  fsm.SetCurrentState(kStateNames[state.GetArg()]);
+  SensorSnapshot sensors;
+  sensors.magneticHeadingError = 0.3;
+  sensors.formationHeadingError = -0.2;
+
+  float trans, rot;
+  bool servoOpen;
+  while(state.KeepRunning()){
+    fsm.ExecuteBehaviour(sensors, trans, rot, servoOpen);
+    BenchmarkKeep(trans);
+    BenchmarkKeep(rot);
+  }
+}
+
+//===========================================================================
+// Actuation and telemetry
+//===========================================================================
+static void BM_WheelSpeeds(BenchmarkState& state){
+  BotController controller;
+  controller.BodyOrientation(0.2);
+  controller.Tick();
+
+  while(state.KeepRunning()){
+    controller.ExecuteBehaviour();
+    BenchmarkKeep(controller.GetLeftMotorSpeed());
+    BenchmarkKeep(controller.GetRightMotorSpeed());
+  }
+}
+
+// Commands as the states give them, so most ticks after a change are
+// ramping and some saturate
+static void BM_DriveOutput(BenchmarkState& state){
+  static const float commands[][2] = {
+    {5., 0.}, {5., 3.}, {-2.5, 0.}, {0., 25.}, {2.5, -8.}, {0., 0.}
+  };
+  static const int numCommands = sizeof(commands) / sizeof(commands[0]);
+
+  int mode = state.GetArg();
+  DriveOutput output;
+  output.SetLimits(mode & 1 ? 8. : 0., mode & 2 ? 50. : 0., mode == 3 ? 6. : 0.);
+
+  float time = 0.;
+  int tick = 0;
+  while(state.KeepRunning()){
+    const float* command = commands[(tick >> 3) % numCommands];
+    output.Update(command[0], command[1], (tick >> 5) & 1, time);
+    BenchmarkKeep(output.GetLeftSpeed());
+    BenchmarkKeep(output.GetRightSpeed());
+    BenchmarkKeep(output.GetServoPosition());
+    time += 0.05;
+    tick++;
+  }
+}
+
+#ifdef BOT_BENCH_ROS
+// The node's preallocated message, refilled and serialised as publish would
+static void BM_WheelMessage(BenchmarkState& state){
+  BotController controller;
+  controller.Tick();
+
+  vrep_common::JointSetStateData wheelSpeedMsg;
+  wheelSpeedMsg.handles.data.resize(2);
+  wheelSpeedMsg.setModes.data.resize(2);
+  wheelSpeedMsg.values.data.resize(2);
+
+  uint8_t buffer[256];
+  while(state.KeepRunning()){
+    wheelSpeedMsg.values.data[0] = controller.GetLeftMotorSpeed();
+    wheelSpeedMsg.values.data[1] = controller.GetRightMotorSpeed();
+    uint32_t length = ros::serialization::serializationLength(wheelSpeedMsg);
+    ros::serialization::OStream stream(buffer, sizeof(buffer));
+    ros::serialization::serialize(stream, wheelSpeedMsg);
+    BenchmarkKeep(length);
+    BenchmarkClobber();
+  }
+}
+#endif
+
+static void BM_Telemetry(BenchmarkState& state){
+  BotController controller;
+  controller.Tick();
+
+  char text[1024];
+  int bytes = 0;
+  while(state.KeepRunning()){
+    bytes = FormatTelemetry(text, sizeof(text), controller);
+    BenchmarkKeep(bytes);
+  }
+  state.SetItemsPerIteration(bytes);
+}
+
+//===========================================================================
+// Main Function
+//===========================================================================
+int main(int argc, char* argv[]){
+
+  static const int blobCounts[] = {0, 1, 2, 4, 8, 16, 32, 64};
+  for(int i = 0; i < 8; i++)
+    RegisterBenchmark("BM_OmniPacket", BM_OmniPacket, blobCounts[i]);
+  for(int i = 0; i < 8; i++)
+    RegisterBenchmark("BM_DecodeAndFuse", BM_DecodeAndFuse, blobCounts[i]);
+  for(int i = 0; i < 8; i++)
+    RegisterBenchmark("BM_FormationHeading", BM_FormationHeading, blobCounts[i]);
+  for(int i = 0; i < 8; i++)
+    RegisterBenchmark("BM_BlobTracker", BM_BlobTracker, blobCounts[i]);
+  RegisterBenchmark("BM_ThresholdRow", BM_ThresholdRow);
+  RegisterBenchmark("BM_ThresholdRowScalar", BM_ThresholdRowScalar);
+  static const int imageSizes[] = {64, 128, 256, 512};
+  static const int markerCounts[] = {0, 4, 16, 64};
+  for(int i = 0; i < 4; i++)
+    for(int j = 0; j < 4; j++)
+      for(int level = 0; level <= 2; level++){
+	char argName[32];
+	snprintf(argName, sizeof(argName), "%d/%d/L%d",
+		 imageSizes[i], markerCounts[j], level);
+	RegisterBenchmark("BM_DetectBlobs", BM_DetectBlobs,
+			  level*1000000 + imageSizes[i]*1000 + markerCounts[j], argName);
+      }
+
+  for(int s = 0; s < kNumStates; s++)
+    RegisterBenchmark("BM_SetCurrentState", BM_SetCurrentState, s, kStateNames[s]);
+  for(int s = 0; s < kNumStates; s++)
+    RegisterBenchmark("BM_UpdateBehaviour", BM_UpdateBehaviour, s, kStateNames[s]);
+  for(int s = 0; s < kNumStates; s++)
+    RegisterBenchmark("BM_ExecuteBehaviour", BM_ExecuteBehaviour, s, kStateNames[s]);
+
+  RegisterBenchmark("BM_WheelSpeeds", BM_WheelSpeeds);
+  static const char* kDriveModes[] = {"none", "speed", "accel", "all"};
+  for(int m = 0; m < 4; m++)
+    RegisterBenchmark("BM_DriveOutput", BM_DriveOutput, m, kDriveModes[m]);
+#ifdef BOT_BENCH_ROS
+  RegisterBenchmark("BM_WheelMessage", BM_WheelMessage);
+#endif
+  RegisterBenchmark("BM_Telemetry", BM_Telemetry);
+
+  return RunBenchmarks(argc, argv);
+}
@@ -33,6 +33,31 @@
 #include "FSM/FSM.h"
 #include "FSM/blobClass.h"
 
+// Sensor decoding, fusion and the FSM, shared with the headless simulator
+#include "BotController.h"
+
+// Optional heap allocation accounting (BOT_ALLOC_TRACKING builds)
+#include "AllocTracker.h"
+
+// Optional real-time profile and loop jitter statistics
+#include "RealTime.h"
+#include "LatencyHistogram.h"
+
+// Sensor to actuator latency statistics
+#include "LatencyTracer.h"
+
+// Optional Chrome trace timeline (BOT_TRACING builds)
+#include "Trace.h"
+
+// Binary recording of the sensor streams for offline replay
+#include "SensorLog.h"
+
+// Console text for V-REP's auxiliary console
+#include "Telemetry.h"
+
+// In-controller blob detection on raw omni images (--raw-omni)
+#include "BlobDetector.h"
+
 using namespace std;
 
 // Create a node for communicating with ROS.
@@ -42,31 +67,40 @@ using namespace std;
 bool simulationRunning=true;
 float simulationTime=0.0f;
 
-// Visual Servoing Data
-vector<blobClass*> frontViewBlobVector;
-vector<blobClass*> leftViewBlobVector;
-vector<blobClass*> rightViewBlobVector;
-vector<blobClass*> rearViewBlobVector;
+// Everything between the sensor callbacks and the wheel commands
+BotController * controller = NULL;
+
+// Actuator messages. These are built once at start up and their fixed size
+// arrays are overwritten in place each tick, so actuation never reallocates.
+vrep_common::JointSetStateData wheelSpeedMsg;
+vrep_common::JointSetStateData servoMsg;
 
-vector<blobClass*> fullBlobVector;
+// The console print request and the text put in it, likewise reused; the
+// request's string keeps the capacity reserved for the whole buffer.
+vrep_common::simRosAuxiliaryConsolePrint consoleMsg;
+char telemetryText[2048];
 
-float magneticHeadingError = 0.;
-float formationHeadingError = 0.;
+// Per stage and end-to-end latency of sensor data through the loop
+LatencyTracer latencyTracer;
 
-// Sensor booleans
-bool frontProxSensor = false;
-bool rearProxSensor = false;
-bool friendLeft = false;
-bool friendRight = false;
-bool friendAhead = false;
-bool friendBehind = false;
-bool aligned = false;
+// Everything fed to the controller, when started with --record=file
+SensorRecorder sensorRecorder;
 
+// With --raw-omni the omni segments arrive as images and are turned into
+// blob filter packets here. The callbacks all run on the spinning thread,
+// so one detector and packet buffer serve the four segments.
+BlobDetector omniDetector;
+vector<float> omniImagePacket;
 
 //===========================================================================
 // Function Prototypes
 //===========================================================================
-void sendMsg2Console(ros::NodeHandle node, int outputHandle, string msg);
+void sendMsg2Console(ros::NodeHandle& node, ros::ServiceClient& consoleClient,
+		     int outputHandle, const char* text);
+void TraceSensor(const ros::Time& stamp, const ros::Time& received, uint64_t decodeStart);
+void RecordPacket(int type, const vrep_common::VisionSensorData::ConstPtr& sens,
+		  uint64_t received);
+void RecordTick();
 
 //===========================================================================
 // Topic subscriber callbacks:
@@ -74,286 +108,231 @@ void sendMsg2Console(ros::NodeHandle node, int outputHandle, string msg);
 void infoCallback(const vrep_common::VrepInfo::ConstPtr& info){
   simulationTime=info->simulationTime.data;
   simulationRunning=(info->simulatorState.data&1)!=0;
+  controller->SetSimulationTime(simulationTime);
+  sensorRecorder.Info(MonotonicNanoseconds(), simulationTime, info->simulatorState.data);
 }
 
 void frontSensorCallback(const vrep_common::ProximitySensorData::ConstPtr& sens){
+  ALLOC_STAGE(STAGE_DECODE);
+  TRACE_SCOPE("frontSensorCallback");
+  ros::Time received = ros::Time::now();
+  uint64_t decodeStart = MonotonicNanoseconds();
   printf("Front sensor.\n");
+  sensorRecorder.Proximity(SENSOR_RECORD_FRONT_PROX, sens->header.stamp.toNSec(), decodeStart);
   
-  frontProxSensor = true;
+  controller->FrontProximity();
+
+  TraceSensor(sens->header.stamp, received, decodeStart);
 }
 
 void rearSensorCallback(const vrep_common::ProximitySensorData::ConstPtr& sens){
+  ALLOC_STAGE(STAGE_DECODE);
+  TRACE_SCOPE("rearSensorCallback");
+  ros::Time received = ros::Time::now();
+  uint64_t decodeStart = MonotonicNanoseconds();
   printf("Rear sensor.\n"); 
+  sensorRecorder.Proximity(SENSOR_RECORD_REAR_PROX, sens->header.stamp.toNSec(), decodeStart);
   
-  rearProxSensor = true;
+  controller->RearProximity();
+
+  TraceSensor(sens->header.stamp, received, decodeStart);
 }
 
 void cameraBlueCallback(const vrep_common::VisionSensorData::ConstPtr& sens){
+  RecordPacket(SENSOR_RECORD_CAMERA_BLUE, sens, MonotonicNanoseconds());
 }
 
 void cameraRedCallback(const vrep_common::VisionSensorData::ConstPtr& sens){
+  RecordPacket(SENSOR_RECORD_CAMERA_RED, sens, MonotonicNanoseconds());
 }
 
-void omniFrontCallback(const vrep_common::VisionSensorData::ConstPtr& sens){
+// The four omni camera segments share one decoder in BotController
+void OmniCallback(int segment, const vrep_common::VisionSensorData::ConstPtr& sens){
+  ALLOC_STAGE(STAGE_DECODE);
+  ros::Time received = ros::Time::now();
+  uint64_t decodeStart = MonotonicNanoseconds();
+  RecordPacket(SENSOR_RECORD_OMNI_FRONT + segment, sens, decodeStart);
   
   // one empty packet plus the number of blobs detected.
   int nPackets = sens->packetSizes.data.size();
-  int numberOfBlobs =  sens->packetData.data[0];
-  int datumPerBlob =  sens->packetData.data[1];
-  // printf("========\nFront # of Blobs= %i\n", numberOfBlobs);
-  if(nPackets < 1){
+  if(nPackets < 1 or sens->packetData.data.size() < 2){
     printf("No packets sent!\n");
     return;
   }
 
-  // If a blob is detected then a team mate is in front.
-  if(numberOfBlobs > 0){
-    friendAhead = true;
-  }
-  else{
-    friendAhead = false;
-  }
-
-  // Record the blobs detected 
-  frontViewBlobVector.clear();
+  controller->OmniPacket(segment, &sens->packetData.data[0],
+			 sens->packetData.data.size());
 
-  // Loop over the detected blobs and add them to the frontViewBlobVector 
-  for(int i = 0; i < numberOfBlobs; i++){
-    blobClass * newBlob = new  blobClass();
-    
-    float blobLocalX =  sens->packetData.data[i*datumPerBlob + 5 ];
-    float blobLocalY =  sens->packetData.data[i*datumPerBlob + 6 ];
-    
-    float blobLocalBearing = atan2( blobLocalY, blobLocalX);
-
-    // TODO: Need to make sure magneticHeadingError's time Stamp matches or is
-    // at least local to the current time.
-    newBlob->blobBearing =  blobLocalBearing - magneticHeadingError;
+  TraceSensor(sens->header.stamp, received, decodeStart);
+}
 
-    float blobWidth =  sens->packetData.data[i * datumPerBlob + 7 ];
-    float blobHeight =  sens->packetData.data[i * datumPerBlob + 8 ]; 
-    newBlob->blobArea =  blobWidth*blobHeight;
-    // printf("%f %f %f \n",blobLocalX, blobLocalY, newBlob->blobBearing);
-    frontViewBlobVector.push_back(newBlob);
-  }
- 
-  formationHeadingError = 0.;
-  
-  /*
-    printf("Front # of Blobs = %i\n", numberOfBlobs); 
-    printf("# of Packets = %d\n", nPackets);
-    for(int i = 0; i < numberOfBlobs; i++){
-    printf("========= BLOB # %i ==========\n",i+1);
-    printf("Blob Size = %f\n", sens->packetData.data[i*datumPerBlob]);
-    printf("Blob Orientation  = %f\n", sens->packetData.data[i*datumPerBlob+1]);
-    printf("Blob X = %f\n", sens->packetData.data[i*datumPerBlob+2]);
-    printf("Blob Y = %f\n", sens->packetData.data[i*datumPerBlob+3]);
-    printf("Blob width  = %f\n", sens->packetData.data[i*datumPerBlob+4]);
-    printf("Blob height = %f\n\n", sens->packetData.data[i*datumPerBlob+5]);
-    }
-  */
+void omniFrontCallback(const vrep_common::VisionSensorData::ConstPtr& sens){
+  TRACE_SCOPE("omniFrontCallback");
+  OmniCallback(OMNI_FRONT, sens);
 }
 
 void omniBackCallback(const vrep_common::VisionSensorData::ConstPtr& sens){
- 
-  // one empty packet plus the number of blobs detected.
-  int nPackets = sens->packetSizes.data.size();
-  int numberOfBlobs =  sens->packetData.data[0];
-  int datumPerBlob =  sens->packetData.data[1];
-
-  if(nPackets < 1){
-    printf("No packets sent!\n");
-    return;
-  }
-  
-  //printf("Back # of Blobs= %i\n", numberOfBlobs); 
-
-  if(numberOfBlobs > 0){
-    friendBehind = true;
-  }
-  else{
-    friendBehind = false;
-  }
-  // Record the blobs detected 
-  rearViewBlobVector.clear();
-
-  // Loop over the detected blobs and add them to the frontViewBlobVector 
-  for(int i = 0; i < numberOfBlobs; i++){
-    blobClass * newBlob = new  blobClass();
-    
-    float blobLocalX =  sens->packetData.data[i*datumPerBlob + 5 ];
-    float blobLocalY =  sens->packetData.data[i*datumPerBlob + 6 ];
-    
-    float blobLocalBearing = atan2( blobLocalY, blobLocalX);
-
-    // TODO: Need to make sure magneticHeadingError's time Stamp matches or is
-    // at least local to the current time.
-    newBlob->blobBearing =  blobLocalBearing - magneticHeadingError;
-    if(newBlob->blobBearing > 0.)
-      newBlob->blobBearing -= M_PI;
-    else
-      newBlob->blobBearing += M_PI;
-
-    float blobWidth =  sens->packetData.data[i * datumPerBlob + 7 ];
-    float blobHeight =  sens->packetData.data[i * datumPerBlob + 8 ]; 
-    newBlob->blobArea =  blobWidth*blobHeight;
-    //printf("%f %f %f \n",blobLocalX, blobLocalY, newBlob->blobBearing);
-    rearViewBlobVector.push_back(newBlob);
-  }
-  return;
+  TRACE_SCOPE("omniBackCallback");
+  OmniCallback(OMNI_BACK, sens);
 }
 
 void omniRightCallback(const vrep_common::VisionSensorData::ConstPtr& sens){
+  TRACE_SCOPE("omniRightCallback");
+  OmniCallback(OMNI_RIGHT, sens);
+}
 
-  
-  // one empty packet plus the number of blobs detected.
-  int nPackets = sens->packetSizes.data.size();
-  int numberOfBlobs =  sens->packetData.data[0];
-  int datumPerBlob =  sens->packetData.data[1];
+void omniLeftCallback(const vrep_common::VisionSensorData::ConstPtr& sens){
+  TRACE_SCOPE("omniLeftCallback");
+  OmniCallback(OMNI_LEFT, sens);
+}
 
-  if(nPackets < 1){
-    printf("No packets sent!\n");
+// Raw image version of OmniCallback. The detected packet is what gets
+// recorded, so a recording replays the same either way.
+void OmniImageCallback(int segment, const sensor_msgs::Image::ConstPtr& image){
+  ALLOC_STAGE(STAGE_DECODE);
+  ros::Time received = ros::Time::now();
+  uint64_t decodeStart = MonotonicNanoseconds();
+
+  if(image->encoding != "rgb8" or image->data.size() < image->height*image->step){
+    printf("Unexpected omni image (%s, %u x %u)\n", image->encoding.c_str(),
+	   image->width, image->height);
     return;
   }
-  // printf("Right # of Blobs= %i\n", numberOfBlobs); 
-  
-  if(numberOfBlobs > 0){
-    friendRight = true;
-  }
-  else{
-    friendRight = false;
-  } 
 
-  // Record the blobs detected 
-  rightViewBlobVector.clear();
+  omniDetector.Detect(&image->data[0], image->width, image->height, image->step,
+		      omniImagePacket);
+  if(sensorRecorder.IsOpen())
+    sensorRecorder.Packet(SENSOR_RECORD_OMNI_FRONT + segment, 1, image->header.stamp.toNSec(),
+			  decodeStart, &omniImagePacket[0], omniImagePacket.size());
 
-  // Loop over the detected blobs and add them to the frontViewBlobVector 
-  for(int i = 0; i < numberOfBlobs; i++){
-    blobClass * newBlob = new  blobClass();
-    
-    float blobLocalX =  sens->packetData.data[i*datumPerBlob + 5 ];
-    float blobLocalY =  sens->packetData.data[i*datumPerBlob + 6 ];
-    
-    float blobLocalBearing = atan2( blobLocalY, blobLocalX);
+  controller->OmniPacket(segment, &omniImagePacket[0], omniImagePacket.size());
 
-    // TODO: Need to make sure magneticHeadingError's time Stamp matches or is
-    // at least local to the current time.
-    newBlob->blobBearing =  blobLocalBearing - magneticHeadingError+M_PI/2.;
+  TraceSensor(image->header.stamp, received, decodeStart);
+}
 
-    float blobWidth =  sens->packetData.data[i * datumPerBlob + 7 ];
-    float blobHeight =  sens->packetData.data[i * datumPerBlob + 8 ]; 
-    newBlob->blobArea =  blobWidth*blobHeight;
-    // printf("%f %f %f \n",blobLocalX, blobLocalY, newBlob->blobBearing);
-    rightViewBlobVector.push_back(newBlob);
-  }
-  return;
+void omniFrontImageCallback(const sensor_msgs::Image::ConstPtr& image){
+  TRACE_SCOPE("omniFrontImageCallback");
+  OmniImageCallback(OMNI_FRONT, image);
 }
 
-void omniLeftCallback(const vrep_common::VisionSensorData::ConstPtr& sens){
-  
-  // one empty packet plus the number of blobs detected.
-  int nPackets = sens->packetSizes.data.size();
-  int numberOfBlobs =  sens->packetData.data[0];
-  int datumPerBlob =  sens->packetData.data[1];
- 
-  if(nPackets < 1){
-    printf("No packets sent!\n");
-    return;
-  }
-  
-  // printf("Left # of Blobs = %i\n", numberOfBlobs); 
-  
-  if(numberOfBlobs > 0){
-    friendLeft = true;
-  }
-  else{
-    friendLeft = false;
-  }
-  
-  // Record the blobs detected 
-  leftViewBlobVector.clear();
-  
-  for(int i = 0; i < numberOfBlobs; i++){
-    blobClass * newBlob = new  blobClass();
-    
-    float blobLocalX =  sens->packetData.data[i*datumPerBlob + 5 ];
-    float blobLocalY =  sens->packetData.data[i*datumPerBlob + 6 ];
-    
-    float blobLocalBearing = atan2( blobLocalY, blobLocalX);
+void omniBackImageCallback(const sensor_msgs::Image::ConstPtr& image){
+  TRACE_SCOPE("omniBackImageCallback");
+  OmniImageCallback(OMNI_BACK, image);
+}
 
-    // TODO: Need to make sure magneticHeadingError's time Stamp matches or is
-    // at least local to the current time.
-    newBlob->blobBearing =  blobLocalBearing - magneticHeadingError-M_PI/2.;
+void omniRightImageCallback(const sensor_msgs::Image::ConstPtr& image){
+  TRACE_SCOPE("omniRightImageCallback");
+  OmniImageCallback(OMNI_RIGHT, image);
+}
 
-    float blobWidth =  sens->packetData.data[i * datumPerBlob + 7 ];
-    float blobHeight =  sens->packetData.data[i * datumPerBlob + 8 ]; 
-    newBlob->blobArea =  blobWidth*blobHeight;
-    //printf("%f %f %f \n",blobLocalX, blobLocalY, newBlob->blobBearing);
-    leftViewBlobVector.push_back(newBlob);
-  }
-  return;
+void omniLeftImageCallback(const sensor_msgs::Image::ConstPtr& image){
+  TRACE_SCOPE("omniLeftImageCallback");
+  OmniImageCallback(OMNI_LEFT, image);
 }
 
 void bodyOrientationCallback(const geometry_msgs::PoseStamped& pose){
+  ALLOC_STAGE(STAGE_DECODE);
+  TRACE_SCOPE("bodyOrientationCallback");
+  ros::Time received = ros::Time::now();
+  uint64_t decodeStart = MonotonicNanoseconds();
 
-  double orientation = tf::getYaw(pose.pose.orientation);
-  
-  magneticHeadingError = orientation + M_PI/2.;
-
-  //printf("magneticError = %f\n",magneticHeadingError);
+  double yaw = tf::getYaw(pose.pose.orientation);
+  sensorRecorder.Pose(pose.header.stamp.toNSec(), decodeStart, yaw);
+  controller->BodyOrientation(yaw);
 
-  if(magneticHeadingError > 0.05)
-    aligned = false;
-  else
-    aligned = true;
+  TraceSensor(pose.header.stamp, received, decodeStart);
 }
 
 /*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
 
-void OpenServo(int servoMotorHandle, ros::Publisher servoPublisher){
- 
-  vrep_common::JointSetStateData servoPosition;
-  float servoPos = 0.;
-  
-  servoPosition.handles.data.push_back(servoMotorHandle);
-  servoPosition.setModes.data.push_back(1);
-  servoPosition.values.data.push_back(servoPos);
-  
-  servoPublisher.publish(servoPosition);
+void InitActuatorMessages(int leftMotorHandle, int rightMotorHandle,
+			  int servoMotorHandle){
+
+  wheelSpeedMsg.handles.data.resize(2);
+  wheelSpeedMsg.setModes.data.resize(2);
+  wheelSpeedMsg.values.data.resize(2);
+
+  wheelSpeedMsg.handles.data[0] = leftMotorHandle;
+  wheelSpeedMsg.handles.data[1] = rightMotorHandle;
+  wheelSpeedMsg.setModes.data[0] = 2; // 2 is the speed mode
+  wheelSpeedMsg.setModes.data[1] = 2;
+  wheelSpeedMsg.values.data[0] = 0.;
+  wheelSpeedMsg.values.data[1] = 0.;
+
+  servoMsg.handles.data.resize(1);
+  servoMsg.setModes.data.resize(1);
+  servoMsg.values.data.resize(1);
+
+  servoMsg.handles.data[0] = servoMotorHandle;
+  servoMsg.setModes.data[0] = 1; // 1 is the position mode
+  servoMsg.values.data[0] = kServoOpenPosition;
 }
 
-void CloseServo(int servoMotorHandle, ros::Publisher servoPublisher){
+void SetServoPosition(const ros::Publisher& servoPublisher, float position){
   
-  vrep_common::JointSetStateData servoPosition;
-  float servoPos = M_PI;
+  servoMsg.values.data[0] = position;
   
-  servoPosition.handles.data.push_back(servoMotorHandle);
-  servoPosition.setModes.data.push_back(1);
-  servoPosition.values.data.push_back(servoPos);
-  
-  servoPublisher.publish(servoPosition);
+  ALLOC_STAGE(STAGE_TRANSPORT);
+  servoPublisher.publish(servoMsg);
+}
+
+void SetWheelSpeeds(const ros::Publisher& wheelSpeedPublisher,
+		    float leftMotorSpeed, float rightMotorSpeed){
+
+  wheelSpeedMsg.values.data[0] = leftMotorSpeed;
+  wheelSpeedMsg.values.data[1] = rightMotorSpeed;
+
+  ALLOC_STAGE(STAGE_TRANSPORT);
+  wheelSpeedPublisher.publish(wheelSpeedMsg);
 }
 
 //===========================================================================
 // Helper Functions
 //===========================================================================
-vector<blobClass*> AppendFirst2Second(vector<blobClass*> v1, vector<blobClass*> v2){
- 
-  for(int i = 0; i < v1.size(); i++)
-    v2.push_back(v1[i]);
-  
-  return v2;
-};
+void TraceSensor(const ros::Time& stamp, const ros::Time& received, uint64_t decodeStart){
+  latencyTracer.SensorDecoded(stamp.toNSec(), received.toNSec(),
+			      decodeStart, MonotonicNanoseconds());
+}
 
-void sendMsg2Console(ros::NodeHandle node, int outputHandle, string msg){
-   
-  ros::ServiceClient consoleClient =
-    node.serviceClient<vrep_common::simRosAuxiliaryConsolePrint>("/vrep/simRosAuxiliaryConsolePrint");
-  vrep_common::simRosAuxiliaryConsolePrint consoleMsg;
+void RecordPacket(int type, const vrep_common::VisionSensorData::ConstPtr& sens,
+		  uint64_t received){
+  if(not sensorRecorder.IsOpen())
+    return;
+
+  const vector<float>& packetData = sens->packetData.data;
+  sensorRecorder.Packet(type, sens->packetSizes.data.size(), sens->header.stamp.toNSec(),
+			received, packetData.empty() ? NULL : &packetData[0],
+			packetData.size());
+}
+
+// What the tick put out, for the replayer to check itself against
+void RecordTick(){
+  if(not sensorRecorder.IsOpen())
+    return;
+
+  SensorTickRecord tick;
+  tick.leftMotorSpeed = controller->GetLeftMotorSpeed();
+  tick.rightMotorSpeed = controller->GetRightMotorSpeed();
+  tick.transSpeed = controller->GetTransSpeed();
+  tick.rotSpeed = controller->GetRotSpeed();
+  tick.servoOpen = controller->GetServoOpen();
+  for(int i = 0; i < kNumStimuli; i++)
+    tick.stimuli[i] = controller->GetStimulus(i);
+  sensorRecorder.Tick(MonotonicNanoseconds(), tick);
+}
+
+// Prints to V-REP's auxiliary console over a persistent connection, made
+// on the first call and again if V-REP drops it
+void sendMsg2Console(ros::NodeHandle& node, ros::ServiceClient& consoleClient,
+		     int outputHandle, const char* text){
  
   consoleMsg.request.consoleHandle=outputHandle;
-  consoleMsg.request.text = msg;
+  consoleMsg.request.text.assign(text);
 
+  ALLOC_STAGE(STAGE_TRANSPORT);
+  if(not consoleClient.isValid())
+    consoleClient =
+      node.serviceClient<vrep_common::simRosAuxiliaryConsolePrint>("/vrep/simRosAuxiliaryConsolePrint", true);
   consoleClient.call(consoleMsg);
 
   return;
@@ -401,7 +380,6 @@ void RequestSubscriber(ros::NodeHandle node, string topicName,
 //===========================================================================
 int main(int argc,char* argv[]){  
 
-  StateManager * fsm = new StateManager();
 
   // Parse the arguments passed to the node
   //===========================================================================
@@ -438,6 +416,64 @@ int main(int argc,char* argv[]){
     sleep(5000);
     return 0;
   }
+
+  // Optional flags follow the object handles
+  RealTimeConfig rtConfig;
+  DefaultRealTimeConfig(rtConfig);
+
+  // Gains and speed levels, overridable with --kp= etc.
+  ControllerParams controllerParams;
+  DefaultControllerParams(controllerParams);
+
+  // Ticks between latency summaries on the console, 0 disables them
+  int latencyReportTicks = 1000;
+
+  // Chrome trace output file, only used in BOT_TRACING builds
+  const char* tracePath = NULL;
+
+  // Detect the omni blobs here from raw images instead of using V-REP's
+  // blob filter
+  bool rawOmni = false;
+  BlobDetectorConfig detectorConfig;
+  DefaultBlobDetectorConfig(detectorConfig);
+
+  for(int i = 14; i < argc; i++){
+    if(ParseRealTimeOption(argv[i], rtConfig)){
+      continue;
+    }
+    else if(ParseControllerParam(argv[i], controllerParams)){
+      continue;
+    }
+    else if(strcmp(argv[i], "--raw-omni") == 0){
+      rawOmni = true;
+    }
+    else if(ParseBlobDetectorOption(argv[i], detectorConfig)){
+      continue;
+    }
+    else if(strncmp(argv[i], "--alloc-strict", 14) == 0){
+      // --alloc-strict[=warmupTicks]
+      int warmupTicks = 100;
+      if(argv[i][14] == '=')
+	warmupTicks = atoi(argv[i] + 15);
+      AllocTrackerSetStrict(warmupTicks);
+    }
+    else if(strncmp(argv[i], "--latency-report=", 17) == 0){
+      latencyReportTicks = atoi(argv[i] + 17);
+    }
+    else if(strncmp(argv[i], "--trace=", 8) == 0){
+      tracePath = argv[i] + 8;
+    }
+    else if(strncmp(argv[i], "--record=", 9) == 0){
+      // Opened here so the write buffer exists before the loop starts
+      sensorRecorder.Open(argv[i] + 9);
+    }
+    else{
+      printf("Unknown option %s\n", argv[i]);
+    }
+  }
+
+  controller = new BotController(controllerParams);
+  omniDetector.SetConfig(detectorConfig);
   //===========================================================================
 
 
@@ -488,15 +524,18 @@ int main(int argc,char* argv[]){
    RequestPublisher(node, "frontCameraBlueData"+randId, 1, 
 		    simros_strmcmd_read_vision_sensor, cameraBlueHandle);
 
-   // Omni-directional camera
-   RequestPublisher(node, "omniFrontData"+randId, 1, 
-		    simros_strmcmd_read_vision_sensor, omniFrontHandle);
-   RequestPublisher(node, "omniBackData"+randId, 1, 
-		    simros_strmcmd_read_vision_sensor, omniBackHandle);
-   RequestPublisher(node, "omniRightData"+randId, 1, 
-		    simros_strmcmd_read_vision_sensor, omniRightHandle);
-   RequestPublisher(node, "omniLeftData"+randId, 1, 
-   simros_strmcmd_read_vision_sensor, omniLeftHandle);
+   // Omni-directional camera, as blob filter packets or raw images
+   string omniTopic = rawOmni ? "Image" : "Data";
+   int omniStreamCmd = rawOmni ? simros_strmcmd_get_vision_sensor_image
+     : simros_strmcmd_read_vision_sensor;
+   RequestPublisher(node, "omniFront"+omniTopic+randId, 1, 
+		    omniStreamCmd, omniFrontHandle);
+   RequestPublisher(node, "omniBack"+omniTopic+randId, 1, 
+		    omniStreamCmd, omniBackHandle);
+   RequestPublisher(node, "omniRight"+omniTopic+randId, 1, 
+		    omniStreamCmd, omniRightHandle);
+   RequestPublisher(node, "omniLeft"+omniTopic+randId, 1, 
+		    omniStreamCmd, omniLeftHandle);
    
    // Compass 
    RequestPublisher(node, "bodyOrientationData"+randId, 1,
@@ -527,25 +566,29 @@ int main(int argc,char* argv[]){
     node.subscribe(frontCameraBlueTopicName.c_str(),1,cameraBlueCallback);
 
  
-  string omniFrontTopicName("/vrep/omniFrontData");
+  string omniFrontTopicName("/vrep/omniFront"+omniTopic);
   omniFrontTopicName += randId; 
-  ros::Subscriber omniFrontSub = 
+  ros::Subscriber omniFrontSub = rawOmni ?
+    node.subscribe(omniFrontTopicName.c_str(),1,omniFrontImageCallback) :
     node.subscribe(omniFrontTopicName.c_str(),1,omniFrontCallback);
  
-  string omniBackTopicName("/vrep/omniBackData");
+  string omniBackTopicName("/vrep/omniBack"+omniTopic);
   omniBackTopicName += randId; 
-  ros::Subscriber omniBackSub = 
+  ros::Subscriber omniBackSub = rawOmni ?
+    node.subscribe(omniBackTopicName.c_str(),1,omniBackImageCallback) :
     node.subscribe(omniBackTopicName.c_str(),1,omniBackCallback);   
   
-  string omniRightTopicName("/vrep/omniRightData");
+  string omniRightTopicName("/vrep/omniRight"+omniTopic);
   omniRightTopicName += randId; 
-  ros::Subscriber omniRightSub = 
+  ros::Subscriber omniRightSub = rawOmni ?
+    node.subscribe(omniRightTopicName.c_str(),1,omniRightImageCallback) :
     node.subscribe(omniRightTopicName.c_str(),1,omniRightCallback);
   
-  string omniLeftTopicName("/vrep/omniLeftData");
+  string omniLeftTopicName("/vrep/omniLeft"+omniTopic);
   omniLeftTopicName += randId; 
-  ros::Subscriber omniLeftSub = 
-  node.subscribe(omniLeftTopicName.c_str(),1,omniLeftCallback);     
+  ros::Subscriber omniLeftSub = rawOmni ?
+    node.subscribe(omniLeftTopicName.c_str(),1,omniLeftImageCallback) :
+    node.subscribe(omniLeftTopicName.c_str(),1,omniLeftCallback);     
   
   string bodyOrientationTopicName("/vrep/bodyOrientationData");
   bodyOrientationTopicName += randId; 
@@ -573,107 +616,113 @@ int main(int argc,char* argv[]){
     node.advertise<vrep_common::JointSetStateData>("servo",1);
 
   RequestSubscriber(node, "/"+nodeName+"/servo", 1, simros_strmcmd_set_joint_state);
+
+  InitActuatorMessages(leftMotorHandle, rightMotorHandle, servoMotorHandle);
+
+  ros::ServiceClient consoleClient;
+  consoleMsg.request.text.reserve(sizeof(telemetryText));
  
   //===========================================================================================================================================================================================
 
   // The start of the control loop
   printf("botModelController started...\n");
-  
-  // These values are passed to the FSM
-  float trans_speed = 5.;
-  float rot_speed = 0.;
-  bool openServo = true;
- 
-  float desiredLeftMotorSpeed = 10.;
-  float desiredRightMotorSpeed = 10.;
+
+  // ROS has started its threads by now, so the control thread can be
+  // separated from them.
+  bool rtRequested = rtConfig.lockMemory or rtConfig.controlCpu >= 0 or rtConfig.fifoPriority > 0;
+  bool rtApplied = false;
+  if(rtRequested)
+    rtApplied = ApplyRealTimeProfile(rtConfig);
+
+  AllocTrackerInit();
+
+  // Tick to tick period of the control loop
+  LatencyHistogram loopJitter;
+  uint64_t lastTickTime = 0;
+  int tickCount = 0;
   
   while (ros::ok() and simulationRunning){
 
-    fullBlobVector.clear();
-    fullBlobVector = AppendFirst2Second( frontViewBlobVector, fullBlobVector);
-    fullBlobVector = AppendFirst2Second( leftViewBlobVector, fullBlobVector);
-    fullBlobVector = AppendFirst2Second( rightViewBlobVector, fullBlobVector);
-    fullBlobVector = AppendFirst2Second( rearViewBlobVector, fullBlobVector);
-    int size = fullBlobVector.size();
-
-    /*
-    printf("=============\n# of Blobs = %i \n",  size);
-    for(int i = 0; i < fullBlobVector.size(); i++){
-      printf("blob # %i bearing %f\n",i,fullBlobVector[i]->blobBearing);
-    }
-    */
-
-    bool stimuli[7];
-    stimuli[0] = frontProxSensor;
-    stimuli[1] = rearProxSensor;
-    stimuli[2] = friendLeft;
-    stimuli[3] = friendRight;
-    stimuli[4] = friendAhead;
-    stimuli[5] = friendBehind;
-    stimuli[6] = aligned;
-
-    // Send stimuli data
-    fsm->UpdateBehaviour(stimuli);
-    fsm->UpdateBlobData(fullBlobVector);
-    // Send visual servo data
-    fsm->SetMagneticHeadingError(magneticHeadingError);
-    fsm->SetFormationHeadingError(formationHeadingError);
-
-    // ExecuteBehaviour will return a translational speed, rotational speed, and a boolean
-    // to determine weather to open or close the servo.
-    fsm->ExecuteBehaviour(trans_speed, rot_speed, openServo);
-    
-    // Depending on what behaviour dictates open/close servo for puck lock
-    if(openServo)
-      OpenServo(servoMotorHandle, servoPublisher);
-    else
-      CloseServo(servoMotorHandle, servoPublisher);
-
-    // Given the translation and rotation speeds dictated by the behaviour
-    // state the desired left and right wheel motors speeds are calculated.
-    desiredLeftMotorSpeed = (2.*trans_speed + rot_speed) / 2.;
-    desiredRightMotorSpeed = (2.*trans_speed - rot_speed) / 2.;
+    uint64_t tickTime = MonotonicNanoseconds();
+    if(lastTickTime != 0)
+      loopJitter.Record(tickTime - lastTickTime);
+    lastTickTime = tickTime;
+
+    ALLOC_SET_STAGE(STAGE_FUSE);
+    controller->FuseSensors();
+
+    ALLOC_SET_STAGE(STAGE_FSM);
+    latencyTracer.BeginUpdate(MonotonicNanoseconds());
+    TRACE_BEGIN("UpdateBehaviour");
+    controller->UpdateBehaviour();
+    TRACE_END("UpdateBehaviour");
+    latencyTracer.EndUpdate(MonotonicNanoseconds());
+
+    // ExecuteBehaviour decides on a translational speed, rotational speed,
+    // the wheel speeds that follow from them and whether to open the servo.
+    TRACE_BEGIN("ExecuteBehaviour");
+    controller->ExecuteBehaviour();
+    TRACE_END("ExecuteBehaviour");
+    latencyTracer.EndExecute(MonotonicNanoseconds());
+
+    ALLOC_SET_STAGE(STAGE_ACTUATE);
+    TRACE_BEGIN("Publish");
+    // Depending on what behaviour dictates open/close servo for puck lock,
+    // moving at the output stage's slew rate
+    SetServoPosition(servoPublisher, controller->GetServoPosition());
  
     // Now that we know what speeds we need the wheels
     // to rotate at we can send that info to V-REP 
-    vrep_common::JointSetStateData motorSpeeds;
-   
-    motorSpeeds.handles.data.push_back(leftMotorHandle);
-    motorSpeeds.handles.data.push_back(rightMotorHandle);
-    motorSpeeds.setModes.data.push_back(2); // 2 is the speed mode
-    motorSpeeds.setModes.data.push_back(2);
-    motorSpeeds.values.data.push_back(desiredLeftMotorSpeed);
-    motorSpeeds.values.data.push_back(desiredRightMotorSpeed);
-         
-    wheelSpeedPublisher.publish(motorSpeeds);
- 
+    SetWheelSpeeds(wheelSpeedPublisher, controller->GetLeftMotorSpeed(),
+		   controller->GetRightMotorSpeed());
+    TRACE_END("Publish");
+    latencyTracer.EndPublish(MonotonicNanoseconds(), ros::Time::now().toNSec());
+    RecordTick();
+
+    ALLOC_SET_STAGE(STAGE_TELEMETRY);
+    TRACE_BEGIN("Telemetry");
     // A message to publish to the console in V-REP for debugging.
-    std::string behaviour = fsm->GetCurrentStateName();
-    std::ostringstream ss;
-    ss << "behaviour = " << behaviour  <<"\n"
-       << "frontProxSensor = " << frontProxSensor <<"\n"
-       << "rearProxSensor = " << rearProxSensor <<"\n"
-       << "friendLeft = " << friendLeft <<"\n"
-       << "friendRight = " << friendRight <<"\n"
-       << "friendAhead = " << friendAhead <<"\n"
-       << "friendBehind = " << friendBehind <<"\n"
-       << "aligned = " << aligned <<"\n"
-       << "transSpeed = " << trans_speed<<"\n"
-       << "rotSpeed = " << rot_speed<<"\n";
+    int length = FormatTelemetry(telemetryText, sizeof(telemetryText), *controller);
+
+    // Periodic latency summary
+    tickCount++;
+    if(latencyReportTicks > 0 and tickCount % latencyReportTicks == 0)
+      latencyTracer.Format(telemetryText + length, sizeof(telemetryText) - length);
     
-    std::string msg(ss.str());
-    sendMsg2Console(node, outputHandle, msg);
+    sendMsg2Console(node, consoleClient, outputHandle, telemetryText);
+    TRACE_END("Telemetry");
+    ALLOC_SET_STAGE(STAGE_OTHER);
 
     // TODO: find a better way to reset the proximity sensors
     // Reset Prox sensors
-    frontProxSensor = false;
-    rearProxSensor = false;
+    controller->ClearProximity();
+
+    AllocTrackerEndTick();
 
     // handle ROS messages:
+    TRACE_BEGIN("spinOnce");
     ros::spinOnce();
+    TRACE_END("spinOnce");
+  }
+
+  AllocTrackerReport();
+
+  // Jitter report, compare runs with and without --rt to see the tail
+  printf("Real-time profile: %s\n",
+	 not rtRequested ? "off" : (rtApplied ? "applied" : "partially applied"));
+  loopJitter.Print(stdout, "Loop period");
+  latencyTracer.Print(stdout);
+
+  if(tracePath != NULL and not TraceWriteChromeJson(tracePath))
+    printf("No trace written, rebuild with BOT_TRACING=ON\n");
+
+  if(sensorRecorder.IsOpen()){
+    printf("Recorded %lu sensor records\n", sensorRecorder.GetRecordCount());
+    sensorRecorder.Close();
   }
 
   // Close down the node.
+  delete controller;
   ros::shutdown();
   printf("...botModelController stopped\n");
   return(0);
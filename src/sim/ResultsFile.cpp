@@ -0,0 +1,94 @@
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+#include "ResultsFile.h"
+
+using namespace std;
+
+static const char kMagic[8] = {'B', 'P', 'F', 'R', 'E', 'S', '1', '\0'};
+static const int kNameLength = 24;
+
+ResultsTable::ResultsTable(){
+  rows = 0;
+}
+
+int ResultsTable::AddFloatColumn(const char* name){
+  Column column;
+  column.name = name;
+  column.type = 0;
+  column.data.resize(rows, 0);
+  columns.push_back(column);
+  return columns.size() - 1;
+}
+
+int ResultsTable::AddUintColumn(const char* name){
+  Column column;
+  column.name = name;
+  column.type = 1;
+  column.data.resize(rows, 0);
+  columns.push_back(column);
+  return columns.size() - 1;
+}
+
+int ResultsTable::AddRow(){
+  for(size_t c = 0; c < columns.size(); c++)
+    columns[c].data.push_back(0);
+  return rows++;
+}
+
+void ResultsTable::SetFloat(int column, int row, float value){
+  uint32_t bits;
+  memcpy(&bits, &value, sizeof(bits));
+  columns[column].data[row] = bits;
+}
+
+void ResultsTable::SetUint(int column, int row, uint32_t value){
+  columns[column].data[row] = value;
+}
+
+float ResultsTable::GetFloat(int column, int row) const{
+  float value;
+  memcpy(&value, &columns[column].data[row], sizeof(value));
+  return value;
+}
+
+uint32_t ResultsTable::GetUint(int column, int row) const{
+  return columns[column].data[row];
+}
+
+int ResultsTable::GetRowCount() const{
+  return rows;
+}
+
+bool ResultsTable::Write(const char* path) const{
+  FILE* file = fopen(path, "wb");
+  if(file == NULL){
+    printf("Cannot open %s for writing\n", path);
+    return false;
+  }
+
+  uint32_t nColumns = columns.size();
+  uint32_t nRows = rows;
+  fwrite(kMagic, 1, sizeof(kMagic), file);
+  fwrite(&nColumns, sizeof(nColumns), 1, file);
+  fwrite(&nRows, sizeof(nRows), 1, file);
+
+  for(size_t c = 0; c < columns.size(); c++){
+    char name[kNameLength];
+    memset(name, 0, sizeof(name));
+    strncpy(name, columns[c].name.c_str(), kNameLength - 1);
+    fwrite(name, 1, kNameLength, file);
+    fwrite(&columns[c].type, sizeof(uint32_t), 1, file);
+  }
+
+  for(size_t c = 0; c < columns.size(); c++)
+    if(rows > 0)
+      fwrite(&columns[c].data[0], sizeof(uint32_t), rows, file);
+
+  bool ok = ferror(file) == 0;
+  fclose(file);
+  return ok;
+}
@@ -0,0 +1,55 @@
+#ifndef RESULTS_FILE_H
+#define RESULTS_FILE_H
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+// Compact columnar results file. Layout, all little endian:
+//
+//   char[8]   magic "BPFRES1\0"
+//   uint32    number of columns
+//   uint32    number of rows
+//   per column:
+//     char[24]  name, NUL padded
+//     uint32    type (0 = float32, 1 = uint32)
+//   per column, in the same order:
+//     rows x 4 bytes of data
+//
+// In numpy: np.fromfile(f, dtype, count=rows, offset=...) per column.
+class ResultsTable{
+
+ public:
+
+  ResultsTable();
+
+  int AddFloatColumn(const char* name);
+  int AddUintColumn(const char* name);
+
+  // Appends a row of zeros and returns its index
+  int AddRow();
+
+  void SetFloat(int column, int row, float value);
+  void SetUint(int column, int row, uint32_t value);
+
+  float GetFloat(int column, int row) const;
+  uint32_t GetUint(int column, int row) const;
+
+  int GetRowCount() const;
+
+  bool Write(const char* path) const;
+
+ private:
+
+  struct Column{
+    string name;
+    uint32_t type;
+    vector<uint32_t> data;   // float32 stored by bit pattern
+  };
+
+  vector<Column> columns;
+  int rows;
+};
+#endif
@@ -0,0 +1,75 @@
+#include <math.h>
+#include <vector>
+
+#include "SpatialGrid.h"
+
+using namespace std;
+
+SpatialGrid::SpatialGrid(){
+  SetCellSize(1.);
+  bucketMask = 0;
+  bucketStart.assign(2, 0);
+}
+
+void SpatialGrid::SetCellSize(float size){
+  cellSize = size;
+  inverseCellSize = 1. / size;
+}
+
+int SpatialGrid::CellCoordinate(float value) const{
+  return (int)floor(value * inverseCellSize);
+}
+
+unsigned int SpatialGrid::Bucket(int cx, int cy) const{
+  unsigned int h = (unsigned int)cx * 73856093u ^ (unsigned int)cy * 19349663u;
+  return h & bucketMask;
+}
+
+void SpatialGrid::Update(const float* xs, const float* ys, int count){
+
+  // About two buckets per point keeps collisions rare
+  unsigned int buckets = 1;
+  while(buckets < 2u * (unsigned int)count)
+    buckets <<= 1;
+
+  bool resized = buckets - 1 != bucketMask or pointBucket.size() != (size_t)count;
+  if(resized){
+    bucketMask = buckets - 1;
+    pointBucket.assign(count, -1);
+    bucketStart.assign(buckets + 1, 0);
+    sortedIndex.resize(count);
+    sortedX.resize(count);
+    sortedY.resize(count);
+  }
+
+  bool moved = resized;
+  for(int i = 0; i < count; i++){
+    int bucket = Bucket(CellCoordinate(xs[i]), CellCoordinate(ys[i]));
+    if(bucket != pointBucket[i]){
+      pointBucket[i] = bucket;
+      moved = true;
+    }
+  }
+
+  if(moved){
+    // Counting sort by bucket
+    bucketStart.assign(buckets + 1, 0);
+    for(int i = 0; i < count; i++)
+      bucketStart[pointBucket[i] + 1]++;
+    for(unsigned int b = 0; b < buckets; b++)
+      bucketStart[b + 1] += bucketStart[b];
+
+    bucketCursor.assign(bucketStart.begin(), bucketStart.end() - 1);
+    for(int i = 0; i < count; i++)
+      sortedIndex[bucketCursor[pointBucket[i]]++] = i;
+  }
+
+  for(int k = 0; k < count; k++){
+    sortedX[k] = xs[sortedIndex[k]];
+    sortedY[k] = ys[sortedIndex[k]];
+  }
+}
+
+int SpatialGrid::GetCount() const{
+  return sortedIndex.size();
+}
@@ -0,0 +1,85 @@
+#ifndef SPATIAL_GRID_H
+#define SPATIAL_GRID_H
+
+#include <math.h>
+#include <vector>
+
+using namespace std;
+
+// Uniform grid over the plane for fixed radius neighbour queries. Cells are
+// hashed into a power of two table so the world needs no bounds. The index
+// is stored as flat arrays sorted by bucket (counting sort), with the
+// positions copied alongside so a query walks contiguous memory.
+//
+// The cell size should be at least the largest query radius, so a query
+// only needs to look at the 3x3 block of cells around its centre.
+class SpatialGrid{
+
+ public:
+
+  SpatialGrid();
+
+  void SetCellSize(float size);
+
+  // Re-indexes the points. The sort is skipped when no point has changed
+  // cell since the last call, only the stored positions are refreshed.
+  void Update(const float* xs, const float* ys, int count);
+
+  // Calls visit(index, dx, dy, distanceSquared) for every point within
+  // radius of (x, y), where (dx, dy) is the offset from (x, y) to the point.
+  template <class Visitor>
+  void ForEachWithin(float x, float y, float radius, Visitor& visit) const;
+
+  int GetCount() const;
+
+ private:
+
+  int CellCoordinate(float value) const;
+  unsigned int Bucket(int cx, int cy) const;
+
+  float cellSize;
+  float inverseCellSize;
+  unsigned int bucketMask;
+
+  vector<int> pointBucket;     // bucket of each point, in input order
+  vector<int> bucketStart;     // prefix sums, size buckets + 1
+  vector<int> bucketCursor;    // scratch for the counting sort
+  vector<int> sortedIndex;     // point indices sorted by bucket
+  vector<float> sortedX;
+  vector<float> sortedY;
+};
+
+template <class Visitor>
+void SpatialGrid::ForEachWithin(float x, float y, float radius, Visitor& visit) const{
+  int cx = CellCoordinate(x);
+  int cy = CellCoordinate(y);
+  float radiusSquared = radius * radius;
+
+  // Neighbouring cells can hash into the same bucket, visit each once
+  unsigned int visited[9];
+  int nVisited = 0;
+
+  for(int oy = -1; oy <= 1; oy++){
+    for(int ox = -1; ox <= 1; ox++){
+      unsigned int bucket = Bucket(cx + ox, cy + oy);
+
+      bool seen = false;
+      for(int k = 0; k < nVisited; k++)
+	if(visited[k] == bucket)
+	  seen = true;
+      if(seen)
+	continue;
+      visited[nVisited++] = bucket;
+
+      int end = bucketStart[bucket + 1];
+      for(int k = bucketStart[bucket]; k < end; k++){
+	float dx = sortedX[k] - x;
+	float dy = sortedY[k] - y;
+	float distanceSquared = dx*dx + dy*dy;
+	if(distanceSquared <= radiusSquared)
+	  visit(sortedIndex[k], dx, dy, distanceSquared);
+      }
+    }
+  }
+}
+#endif
@@ -0,0 +1,275 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <vector>
+
+#include "SwarmSim.h"
+#include "../BotController.h"
+
+using namespace std;
+
+// Values per blob in the synthetic packets, as V-REP's blob filter sends
+static const int kDatumPerBlob = 6;
+
+// Radius at which blobs are placed in the omni image and the scale of their
+// apparent size
+static const float kImageRadius = 0.25;
+static const float kBlobScale = 0.5;
+
+static float WrapAngle(float angle){
+  while(angle > M_PI)
+    angle -= 2.*M_PI;
+  while(angle <= -M_PI)
+    angle += 2.*M_PI;
+  return angle;
+}
+
+void DefaultSwarmSimConfig(SwarmSimConfig& config){
+  config.numRobots = 10;
+  config.seed = 1;
+  config.dt = 0.05;
+  config.spawnSize = 2.;
+  config.wheelRadius = 0.02;
+  config.axleLength = 0.1;
+  config.robotDiameter = 0.12;
+  config.cameraRange = 1.5;
+  config.proxRange = 0.15;
+  config.proxHalfAngle = M_PI/6.;
+  config.blobDropout = 0.;
+  config.ticksPerFrame = 1;
+  config.useSpatialGrid = true;
+  DefaultControllerParams(config.controller);
+}
+
+SwarmSim::SwarmSim(const SwarmSimConfig& config){
+  this->config = config;
+  simulationTime = 0.;
+  randomState = config.seed != 0 ? config.seed : 1;
+  stepCount = 0;
+  cameraFrame = true;
+  recorder = NULL;
+  recordRobot = -1;
+  recordingRobot = false;
+
+  robots.resize(config.numRobots);
+  for(int i = 0; i < config.numRobots; i++){
+    SimRobot& robot = robots[i];
+    robot.x = (Random() - 0.5) * config.spawnSize;
+    robot.y = (Random() - 0.5) * config.spawnSize;
+    robot.yaw = (Random() - 0.5) * 2.*M_PI;
+    robot.controller = new BotController(config.controller);
+  }
+
+  for(int s = 0; s < OMNI_SEGMENT_COUNT; s++)
+    packets[s].reserve(3 + config.numRobots*kDatumPerBlob);
+
+  float cellSize = config.cameraRange > config.proxRange ? config.cameraRange : config.proxRange;
+  grid.SetCellSize(cellSize);
+  positionX.resize(config.numRobots);
+  positionY.resize(config.numRobots);
+}
+
+SwarmSim::~SwarmSim(){
+  for(int i = 0; i < config.numRobots; i++)
+    delete robots[i].controller;
+}
+
+//===========================================================================
+// Simulation
+//===========================================================================
+void SwarmSim::Step(){
+
+  int ticksPerFrame = config.ticksPerFrame > 1 ? config.ticksPerFrame : 1;
+  cameraFrame = stepCount % ticksPerFrame == 0;
+
+  if(config.useSpatialGrid){
+    for(int i = 0; i < config.numRobots; i++){
+      positionX[i] = robots[i].x;
+      positionY[i] = robots[i].y;
+    }
+    grid.Update(&positionX[0], &positionY[0], robots.size());
+  }
+
+  for(int i = 0; i < config.numRobots; i++){
+    Sense(i);
+    robots[i].controller->Tick();
+    if(i == recordRobot)
+      RecordTick(robots[i].controller);
+  }
+
+  // Move everybody only once all of them have sensed the same world
+  for(int i = 0; i < config.numRobots; i++){
+    SimRobot& robot = robots[i];
+    float left = robot.controller->GetLeftMotorSpeed();
+    float right = robot.controller->GetRightMotorSpeed();
+
+    double v = config.wheelRadius * (left + right) / 2.;
+    double omega = config.wheelRadius * (right - left) / config.axleLength;
+
+    robot.x += v * cos(robot.yaw) * config.dt;
+    robot.y += v * sin(robot.yaw) * config.dt;
+    robot.yaw = WrapAngle(robot.yaw + omega * config.dt);
+  }
+
+  simulationTime += config.dt;
+  stepCount++;
+}
+
+void SwarmSim::Sense(int index){
+  SimRobot& robot = robots[index];
+  BotController* controller = robot.controller;
+
+  for(int s = 0; s < OMNI_SEGMENT_COUNT; s++){
+    packets[s].resize(2);
+    packets[s][kOmniBlobCountIndex] = 0;
+    packets[s][kOmniDatumPerBlobIndex] = kDatumPerBlob;
+  }
+
+  float range = config.cameraRange > config.proxRange ? config.cameraRange : config.proxRange;
+  recordingRobot = index == recordRobot;
+
+  if(config.useSpatialGrid){
+    NeighbourVisitor visit;
+    visit.sim = this;
+    visit.self = index;
+    visit.controller = controller;
+    visit.yaw = robot.yaw;
+    grid.ForEachWithin(robot.x, robot.y, range, visit);
+  }
+  else{
+    float rangeSquared = range * range;
+    for(int j = 0; j < config.numRobots; j++){
+      if(j == index)
+	continue;
+
+      float dx = robots[j].x - robot.x;
+      float dy = robots[j].y - robot.y;
+      float distanceSquared = dx*dx + dy*dy;
+      if(distanceSquared <= rangeSquared)
+	SenseNeighbour(controller, robot.yaw, dx, dy, distanceSquared);
+    }
+  }
+
+  controller->SetSimulationTime(simulationTime);
+  controller->BodyOrientation(robot.yaw);
+  if(cameraFrame){
+    for(int s = 0; s < OMNI_SEGMENT_COUNT; s++)
+      controller->OmniPacket(s, &packets[s][0], packets[s].size());
+  }
+
+  if(recordingRobot){
+    uint64_t now = SimulationNanoseconds();
+    recorder->Info(now, simulationTime, 1);
+    recorder->Pose(now, now, robot.yaw);
+    for(int s = 0; cameraFrame and s < OMNI_SEGMENT_COUNT; s++)
+      recorder->Packet(SENSOR_RECORD_OMNI_FRONT + s, 1, now, now,
+		       &packets[s][0], packets[s].size());
+  }
+}
+
+// Proximity hits and the omni camera blob for one robot in range
+void SwarmSim::SenseNeighbour(BotController* controller, double yaw,
+			      float dx, float dy, float distanceSquared){
+  float distance = sqrt(distanceSquared);
+
+  // The controller measures bearings clockwise from the front of the robot
+  float bearing = -WrapAngle(atan2(dy, dx) - yaw);
+
+  if(distance < config.proxRange){
+    int hit = -1;
+    if(fabs(bearing) < config.proxHalfAngle){
+      controller->FrontProximity();
+      hit = SENSOR_RECORD_FRONT_PROX;
+    }
+    else if(fabs(WrapAngle(bearing - M_PI)) < config.proxHalfAngle){
+      controller->RearProximity();
+      hit = SENSOR_RECORD_REAR_PROX;
+    }
+    if(hit >= 0 and recordingRobot)
+      recorder->Proximity(hit, SimulationNanoseconds(), SimulationNanoseconds());
+  }
+
+  if(not cameraFrame or distance > config.cameraRange)
+    return;
+  if(config.blobDropout > 0. and Random() < config.blobDropout)
+    return;
+
+  // Each segment covers a quarter of the circle, centred on its axis
+  if(fabs(bearing) <= M_PI/4.)
+    AddBlob(OMNI_FRONT, bearing, distance);
+  else if(bearing > M_PI/4. and bearing <= 3.*M_PI/4.)
+    AddBlob(OMNI_RIGHT, bearing - M_PI/2., distance);
+  else if(bearing < -M_PI/4. and bearing >= -3.*M_PI/4.)
+    AddBlob(OMNI_LEFT, bearing + M_PI/2., distance);
+  else
+    AddBlob(OMNI_BACK, WrapAngle(bearing - M_PI), distance);
+}
+
+// Appends one blob in the layout BotController::OmniPacket reads
+void SwarmSim::AddBlob(int segment, float localBearing, float distance){
+  vector<float>& packet = packets[segment];
+  int blob = packet[kOmniBlobCountIndex];
+
+  packet.resize(3 + (blob + 1)*kDatumPerBlob);
+
+  float size = kBlobScale * config.robotDiameter / distance;
+  if(size > 1.)
+    size = 1.;
+
+  packet[blob*kDatumPerBlob + kOmniBlobXOffset] = kImageRadius * cos(localBearing);
+  packet[blob*kDatumPerBlob + kOmniBlobYOffset] = kImageRadius * sin(localBearing);
+  packet[blob*kDatumPerBlob + kOmniBlobWidthOffset] = size;
+  packet[blob*kDatumPerBlob + kOmniBlobHeightOffset] = size;
+  packet[kOmniBlobCountIndex] = blob + 1;
+}
+
+//===========================================================================
+// Recording
+//===========================================================================
+void SwarmSim::SetRecorder(SensorRecorder* recorder, int robot){
+  this->recorder = recorder;
+  recordRobot = recorder != NULL ? robot : -1;
+}
+
+void SwarmSim::RecordTick(BotController* controller){
+  SensorTickRecord tick;
+  tick.leftMotorSpeed = controller->GetLeftMotorSpeed();
+  tick.rightMotorSpeed = controller->GetRightMotorSpeed();
+  tick.transSpeed = controller->GetTransSpeed();
+  tick.rotSpeed = controller->GetRotSpeed();
+  tick.servoOpen = controller->GetServoOpen();
+  for(int i = 0; i < kNumStimuli; i++)
+    tick.stimuli[i] = controller->GetStimulus(i);
+  recorder->Tick(SimulationNanoseconds(), tick);
+}
+
+uint64_t SwarmSim::SimulationNanoseconds(){
+  return (uint64_t)(simulationTime * 1e9 + 0.5);
+}
+
+//===========================================================================
+// Accessors
+//===========================================================================
+int SwarmSim::GetNumRobots(){
+  return robots.size();
+}
+
+SimRobot& SwarmSim::GetRobot(int index){
+  return robots[index];
+}
+
+float SwarmSim::GetTime(){
+  return simulationTime;
+}
+
+const SwarmSimConfig& SwarmSim::GetConfig(){
+  return config;
+}
+
+// xorshift32, so runs are reproducible from the seed alone
+float SwarmSim::Random(){
+  randomState ^= randomState << 13;
+  randomState ^= randomState >> 17;
+  randomState ^= randomState << 5;
+  return (randomState >> 8) / 16777216.;
+}
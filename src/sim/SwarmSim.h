@@ -0,0 +1,111 @@
+#ifndef SWARM_SIM_H
+#define SWARM_SIM_H
+
+#include <vector>
+
+#include "../BotController.h"
+#include "../SensorLog.h"
+#include "SpatialGrid.h"
+
+using namespace std;
+
+// Headless kinematic stand-in for the V-REP scene. Each robot is a
+// differential drive BuPiGo with front/rear proximity sensors and a four
+// segment omni camera. Sensor data is synthesised in exactly the form the
+// ROS callbacks hand to BotController, so the controller code under test is
+// the same code that runs in the node.
+struct SwarmSimConfig{
+  int numRobots;
+  unsigned int seed;
+
+  float dt;               // seconds per step
+  float spawnSize;        // robots start uniformly inside a square this wide
+
+  float wheelRadius;      // metres
+  float axleLength;       // metres
+  float robotDiameter;    // metres
+
+  float cameraRange;      // omni camera sees other robots within this range
+  float proxRange;        // proximity sensor range
+  float proxHalfAngle;    // half width of the proximity cone (radians)
+  float blobDropout;      // chance a robot in camera range is missed in a
+                          // frame, as V-REP's blob filter sometimes does
+  int ticksPerFrame;      // control ticks per omni camera frame; the ticks
+                          // in between get pose and proximity only
+
+  bool useSpatialGrid;    // false falls back to the O(N^2) all pairs scan
+
+  ControllerParams controller;  // shared by every robot
+};
+
+void DefaultSwarmSimConfig(SwarmSimConfig& config);
+
+struct SimRobot{
+  double x;
+  double y;
+  double yaw;             // counter clockwise, radians
+  BotController* controller;
+};
+
+class SwarmSim{
+
+ public:
+
+  SwarmSim(const SwarmSimConfig& config);
+  ~SwarmSim();
+
+  // Sense, run every controller for one tick, then move every robot.
+  void Step();
+
+  int GetNumRobots();
+  SimRobot& GetRobot(int index);
+  float GetTime();
+  const SwarmSimConfig& GetConfig();
+
+  // Records everything one robot's controller is fed, in the format the
+  // node writes with --record, stamped with simulation time.
+  void SetRecorder(SensorRecorder* recorder, int robot);
+
+ private:
+
+  void Sense(int index);
+  void SenseNeighbour(BotController* controller, double yaw,
+		      float dx, float dy, float distanceSquared);
+  void AddBlob(int segment, float localBearing, float distance);
+  void RecordTick(BotController* controller);
+  uint64_t SimulationNanoseconds();
+
+  // Hands grid query results back to SenseNeighbour
+  struct NeighbourVisitor{
+    SwarmSim* sim;
+    int self;
+    BotController* controller;
+    double yaw;
+    void operator()(int index, float dx, float dy, float distanceSquared){
+      if(index != self)
+	sim->SenseNeighbour(controller, yaw, dx, dy, distanceSquared);
+    };
+  };
+
+  float Random();
+
+  SwarmSimConfig config;
+  vector<SimRobot> robots;
+  float simulationTime;
+  unsigned int randomState;
+  long stepCount;
+  bool cameraFrame;       // this step delivers an omni frame
+
+  SensorRecorder* recorder;
+  int recordRobot;
+  bool recordingRobot;    // the robot being sensed is the recorded one
+
+  // Reused omni packets, one per camera segment
+  vector<float> packets[OMNI_SEGMENT_COUNT];
+
+  // Neighbour index, rebuilt from the positions at the start of each step
+  SpatialGrid grid;
+  vector<float> positionX;
+  vector<float> positionY;
+};
+#endif
@@ -0,0 +1,159 @@
+#include <math.h>
+#include <pthread.h>
+#include <vector>
+
+#include "Trial.h"
+#include "SwarmSim.h"
+
+using namespace std;
+
+struct TrialQueue{
+  const vector<TrialConfig>* configs;
+  vector<TrialResult>* results;
+  int nextTrial;
+};
+
+void DefaultTrialConfig(TrialConfig& config){
+  DefaultSwarmSimConfig(config.sim);
+  config.maxTime = 300.;
+  config.errorThreshold = 0.15;
+  config.holdTime = 2.;
+}
+
+float LineFormationError(SwarmSim& sim){
+  int n = sim.GetNumRobots();
+  if(n < 3)
+    return 0.;
+
+  double meanX = 0., meanY = 0.;
+  for(int i = 0; i < n; i++){
+    meanX += sim.GetRobot(i).x;
+    meanY += sim.GetRobot(i).y;
+  }
+  meanX /= n;
+  meanY /= n;
+
+  double sxx = 0., syy = 0., sxy = 0.;
+  for(int i = 0; i < n; i++){
+    double dx = sim.GetRobot(i).x - meanX;
+    double dy = sim.GetRobot(i).y - meanY;
+    sxx += dx*dx;
+    syy += dy*dy;
+    sxy += dx*dy;
+  }
+
+  // The smaller eigenvalue of the covariance is the variance across the line
+  double trace = sxx + syy;
+  double det = sxx*syy - sxy*sxy;
+  double across = trace/2. - sqrt(trace*trace/4. - det > 0. ? trace*trace/4. - det : 0.);
+  if(across < 0.)
+    across = 0.;
+
+  return sqrt(across / n);
+}
+
+void RunTrial(const TrialConfig& config, TrialResult& result){
+  SwarmSim sim(config.sim);
+
+  result.seed = config.sim.seed;
+  result.converged = false;
+  result.convergenceTime = config.maxTime;
+
+  float holdStart = -1.;
+  float error = LineFormationError(sim);
+
+  int n = sim.GetNumRobots();
+  vector<float> alignedSince(n, -1.);
+  vector<float> settledAt(n, -1.);
+
+  while(sim.GetTime() < config.maxTime){
+    sim.Step();
+    error = LineFormationError(sim);
+
+    for(int i = 0; i < n; i++){
+      if(settledAt[i] >= 0.)
+	continue;
+      if(fabs(sim.GetRobot(i).controller->GetMagneticHeadingError()) < config.sim.controller.alignThreshold){
+	if(alignedSince[i] < 0.)
+	  alignedSince[i] = sim.GetTime();
+	if(sim.GetTime() - alignedSince[i] >= config.holdTime)
+	  settledAt[i] = alignedSince[i];
+      }
+      else
+	alignedSince[i] = -1.;
+    }
+
+    if(error < config.errorThreshold){
+      if(holdStart < 0.)
+	holdStart = sim.GetTime();
+      if(sim.GetTime() - holdStart >= config.holdTime){
+	result.converged = true;
+	result.convergenceTime = holdStart;
+	break;
+      }
+    }
+    else{
+      holdStart = -1.;
+    }
+  }
+
+  int aligned = 0;
+  for(int i = 0; i < sim.GetNumRobots(); i++)
+    if(fabs(sim.GetRobot(i).controller->GetMagneticHeadingError()) < config.sim.controller.alignThreshold)
+      aligned++;
+
+  result.finalError = error;
+  result.alignedFraction = aligned / (float)sim.GetNumRobots();
+
+  float settleSum = 0.;
+  for(int i = 0; i < n; i++)
+    settleSum += settledAt[i] >= 0. ? settledAt[i] : sim.GetTime();
+  result.headingSettleTime = n > 0 ? settleSum / n : 0.;
+
+  long transitions = 0;
+  long rawChanges = 0;
+  long filteredChanges = 0;
+  for(int i = 0; i < sim.GetNumRobots(); i++){
+    BotController* controller = sim.GetRobot(i).controller;
+    transitions += controller->GetStateManager()->GetTransitionCount();
+    rawChanges += controller->GetStimulusFilter().GetRawChanges();
+    filteredChanges += controller->GetStimulusFilter().GetFilteredChanges();
+  }
+  float robotSeconds = sim.GetNumRobots() * sim.GetTime();
+  if(robotSeconds <= 0.)
+    robotSeconds = 1.;
+  result.transitionRate = transitions / robotSeconds;
+  result.rawStimulusRate = rawChanges / robotSeconds;
+  result.filteredStimulusRate = filteredChanges / robotSeconds;
+}
+
+static void* TrialWorker(void* arg){
+  TrialQueue* queue = (TrialQueue*)arg;
+  int trials = queue->configs->size();
+
+  while(true){
+    int trial = __sync_fetch_and_add(&queue->nextTrial, 1);
+    if(trial >= trials)
+      break;
+    RunTrial((*queue->configs)[trial], (*queue->results)[trial]);
+  }
+  return NULL;
+}
+
+void RunTrials(const vector<TrialConfig>& configs, vector<TrialResult>& results,
+	       int threads){
+  results.resize(configs.size());
+  if(threads < 1)
+    threads = 1;
+
+  TrialQueue queue;
+  queue.configs = &configs;
+  queue.results = &results;
+  queue.nextTrial = 0;
+
+  vector<pthread_t> workers(threads);
+  for(int t = 0; t < threads; t++)
+    pthread_create(&workers[t], NULL, TrialWorker, &queue);
+  for(int t = 0; t < threads; t++)
+    pthread_join(workers[t], NULL);
+}
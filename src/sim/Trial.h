@@ -0,0 +1,50 @@
+#ifndef TRIAL_H
+#define TRIAL_H
+
+#include <vector>
+
+#include "SwarmSim.h"
+
+using namespace std;
+
+// One formation trial: a seeded swarm run until the robots hold a line or
+// the time runs out.
+struct TrialConfig{
+  SwarmSimConfig sim;
+  float maxTime;          // seconds of simulated time before giving up
+  float errorThreshold;   // metres, RMS distance from the fitted line
+  float holdTime;         // seconds the threshold must hold to count
+};
+
+struct TrialResult{
+  unsigned int seed;
+  bool converged;
+  float convergenceTime;  // when the hold started, maxTime if never
+  float finalError;
+  float alignedFraction;  // robots within the alignment tolerance at the end
+  float headingSettleTime;  // mean over the robots of when their heading
+                            // error first came within the alignment
+                            // tolerance to stay for holdTime, the end of
+                            // the trial for those that never did
+
+  // Per robot per second of simulated time, averaged over the swarm: FSM
+  // state changes, and stimulus changes before and after StimulusFilter
+  float transitionRate;
+  float rawStimulusRate;
+  float filteredStimulusRate;
+};
+
+void DefaultTrialConfig(TrialConfig& config);
+
+// RMS perpendicular distance of the robots from their principal axis, i.e.
+// how far the swarm is from being a single straight line.
+float LineFormationError(SwarmSim& sim);
+
+void RunTrial(const TrialConfig& config, TrialResult& result);
+
+// Runs every trial on a pool of worker threads, handing them out one at a
+// time. results is resized to match configs.
+void RunTrials(const vector<TrialConfig>& configs, vector<TrialResult>& results,
+	       int threads);
+
+#endif
@@ -0,0 +1,161 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <algorithm>
+#include <vector>
+
+#include "Trial.h"
+#include "ResultsFile.h"
+
+using namespace std;
+
+//===========================================================================
+// Parallel Monte Carlo runner for formation trials
+//
+//   botExperimentRunner [--trials=T] [--threads=K] [--robots=N] [--seed=X]
+//                       [--max-time=S] [--threshold=E] [--hold=H]
+//                       [--spawn=W] [--blob-dropout=P] [--ticks-per-frame=F]
+//                       [--out=results.bin]
+//                       [controller parameters, see ControllerParams.h]
+//
+// Trial i runs the headless simulator with seed X+i, so any single trial
+// can be reproduced with botSwarmSim --seed=X+i. Trials are handed out to
+// the worker threads one at a time.
+//===========================================================================
+
+static double WallSeconds(){
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static void PrintDistribution(const char* label, vector<float> values){
+  if(values.empty()){
+    printf("  %-18s (none)\n", label);
+    return;
+  }
+  sort(values.begin(), values.end());
+
+  int n = values.size();
+  double sum = 0.;
+  for(int i = 0; i < n; i++)
+    sum += values[i];
+
+  printf("  %-18s mean=%8.3f p10=%8.3f p50=%8.3f p90=%8.3f max=%8.3f\n", label,
+	 sum / n, values[n/10], values[n/2], values[(n*9)/10], values[n-1]);
+}
+
+int main(int argc, char* argv[]){
+
+  TrialConfig config;
+  DefaultTrialConfig(config);
+  int trials = 100;
+
+  int threads = sysconf(_SC_NPROCESSORS_ONLN);
+  const char* outPath = NULL;
+
+  for(int i = 1; i < argc; i++){
+    if(strncmp(argv[i], "--trials=", 9) == 0)
+      trials = atoi(argv[i] + 9);
+    else if(strncmp(argv[i], "--threads=", 10) == 0)
+      threads = atoi(argv[i] + 10);
+    else if(strncmp(argv[i], "--robots=", 9) == 0)
+      config.sim.numRobots = atoi(argv[i] + 9);
+    else if(strncmp(argv[i], "--seed=", 7) == 0)
+      config.sim.seed = strtoul(argv[i] + 7, NULL, 10);
+    else if(strncmp(argv[i], "--max-time=", 11) == 0)
+      config.maxTime = atof(argv[i] + 11);
+    else if(strncmp(argv[i], "--threshold=", 12) == 0)
+      config.errorThreshold = atof(argv[i] + 12);
+    else if(strncmp(argv[i], "--hold=", 7) == 0)
+      config.holdTime = atof(argv[i] + 7);
+    else if(strncmp(argv[i], "--spawn=", 8) == 0)
+      config.sim.spawnSize = atof(argv[i] + 8);
+    else if(strncmp(argv[i], "--blob-dropout=", 15) == 0)
+      config.sim.blobDropout = atof(argv[i] + 15);
+    else if(strncmp(argv[i], "--ticks-per-frame=", 18) == 0)
+      config.sim.ticksPerFrame = atoi(argv[i] + 18);
+    else if(strncmp(argv[i], "--out=", 6) == 0)
+      outPath = argv[i] + 6;
+    else if(ParseControllerParam(argv[i], config.sim.controller))
+      continue;
+    else{
+      printf("Unknown option %s\n", argv[i]);
+      return 1;
+    }
+  }
+  if(threads < 1)
+    threads = 1;
+
+  vector<TrialConfig> configs(trials, config);
+  for(int i = 0; i < trials; i++)
+    configs[i].sim.seed = config.sim.seed + i;
+
+  vector<TrialResult> results;
+  double start = WallSeconds();
+  RunTrials(configs, results, threads);
+  double elapsed = WallSeconds() - start;
+
+  // Summary
+  vector<float> convergenceTimes;
+  vector<float> finalErrors;
+  vector<float> settleTimes;
+  vector<float> transitionRates;
+  vector<float> rawStimulusRates;
+  vector<float> filteredStimulusRates;
+  for(int i = 0; i < trials; i++){
+    if(results[i].converged)
+      convergenceTimes.push_back(results[i].convergenceTime);
+    finalErrors.push_back(results[i].finalError);
+    settleTimes.push_back(results[i].headingSettleTime);
+    transitionRates.push_back(results[i].transitionRate);
+    rawStimulusRates.push_back(results[i].rawStimulusRate);
+    filteredStimulusRates.push_back(results[i].filteredStimulusRate);
+  }
+
+  printf("%d trials of %d robots on %d threads in %.2f s\n", trials,
+	 config.sim.numRobots, threads, elapsed);
+  printf("  converged          %d/%d (threshold %.3f m for %.1f s, limit %.0f s)\n",
+	 (int)convergenceTimes.size(), trials, config.errorThreshold,
+	 config.holdTime, config.maxTime);
+  PrintDistribution("convergence time", convergenceTimes);
+  PrintDistribution("final error", finalErrors);
+  PrintDistribution("heading settle", settleTimes);
+  printf("  per robot per second:\n");
+  PrintDistribution("transitions", transitionRates);
+  PrintDistribution("stimuli raw", rawStimulusRates);
+  PrintDistribution("stimuli filtered", filteredStimulusRates);
+
+  if(outPath != NULL){
+    ResultsTable table;
+    int seedColumn = table.AddUintColumn("seed");
+    int convergedColumn = table.AddUintColumn("converged");
+    int timeColumn = table.AddFloatColumn("convergence_time");
+    int errorColumn = table.AddFloatColumn("final_error");
+    int alignedColumn = table.AddFloatColumn("aligned_fraction");
+    int settleColumn = table.AddFloatColumn("heading_settle_time");
+    int transitionColumn = table.AddFloatColumn("transition_rate");
+    int rawColumn = table.AddFloatColumn("raw_stimulus_rate");
+    int filteredColumn = table.AddFloatColumn("filtered_stimulus_rate");
+
+    for(int i = 0; i < trials; i++){
+      const TrialResult& result = results[i];
+      int row = table.AddRow();
+      table.SetUint(seedColumn, row, result.seed);
+      table.SetUint(convergedColumn, row, result.converged ? 1 : 0);
+      table.SetFloat(timeColumn, row, result.convergenceTime);
+      table.SetFloat(errorColumn, row, result.finalError);
+      table.SetFloat(alignedColumn, row, result.alignedFraction);
+      table.SetFloat(settleColumn, row, result.headingSettleTime);
+      table.SetFloat(transitionColumn, row, result.transitionRate);
+      table.SetFloat(rawColumn, row, result.rawStimulusRate);
+      table.SetFloat(filteredColumn, row, result.filteredStimulusRate);
+    }
+    if(table.Write(outPath))
+      printf("Results written to %s\n", outPath);
+  }
+
+  return 0;
+}
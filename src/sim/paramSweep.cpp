@@ -0,0 +1,376 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include <unistd.h>
+#include <algorithm>
+#include <vector>
+
+#include "Trial.h"
+#include "ResultsFile.h"
+#include "../FSM/ControllerParams.h"
+
+using namespace std;
+
+//===========================================================================
+// Parameter sweep and optimiser over the controller gains and speeds
+//
+//   botParamSweep [--mode=grid|random|cmaes] [--params=catchup-kp,cruise,...]
+//                 [--levels=L] [--candidates=N]
+//                 [--generations=G] [--population=P]
+//                 [--trials=K] [--robots=N] [--max-time=S] [--seed=X]
+//                 [--threads=T] [--top=M] [--out=sweep.bin]
+//
+// Every candidate is scored on the same K seeds (common random numbers) by
+// its mean time to formation, with trials that never converge counting as
+// the time limit. Parameters not named in --params keep their defaults.
+//===========================================================================
+
+struct ParamRange{
+  const char* name;
+  float ControllerParams::* field;
+  float low;
+  float high;
+};
+
+static const ParamRange kRanges[] = {
+  {"catchup-kp",   &ControllerParams::catchUpKp,           0.5,  10.},
+  {"impulse-kp",   &ControllerParams::impulseKp,           0.5,  10.},
+  {"align-kp",     &ControllerParams::alignKp,             1.,   20.},
+  {"catchup-ki",   &ControllerParams::catchUpKi,           0.,   4.},
+  {"feed-forward", &ControllerParams::steeringFeedForward, 0.,   8.},
+  {"cruise",       &ControllerParams::cruiseSpeed,         2.,   10.},
+  {"slow",         &ControllerParams::slowSpeed,           1.,   6.},
+  {"reverse",      &ControllerParams::reverseSpeed,       -6.,  -1.},
+  {"align",        &ControllerParams::alignThreshold,      0.01, 0.3},
+  {"evade",        &ControllerParams::evadeDuration,       1.,   8.}
+};
+static const int kNumRanges = sizeof(kRanges) / sizeof(kRanges[0]);
+
+// Whether name is one of the comma separated entries of list. Whole
+// entries only, as "align" is a prefix of "align-kp".
+static bool ListHasName(const char* list, const char* name){
+  int length = strlen(name);
+  const char* entry = list;
+  while(true){
+    const char* end = strchr(entry, ',');
+    int entryLength = end != NULL ? end - entry : strlen(entry);
+    if(entryLength == length and strncmp(entry, name, length) == 0)
+      return true;
+    if(end == NULL)
+      return false;
+    entry = end + 1;
+  }
+}
+
+struct Candidate{
+  ControllerParams params;
+  vector<float> point;     // position in the unit cube of the swept params
+  float score;             // mean time to formation, lower is better
+  float convergedFraction;
+};
+
+static bool CandidateBetter(const Candidate& a, const Candidate& b){
+  return a.score < b.score;
+}
+
+//===========================================================================
+// Helper Functions
+//===========================================================================
+static unsigned int randomState = 1;
+
+static float Uniform(){
+  randomState ^= randomState << 13;
+  randomState ^= randomState >> 17;
+  randomState ^= randomState << 5;
+  return ((randomState >> 8) + 0.5) / 16777216.;
+}
+
+static float Gaussian(){
+  return sqrt(-2. * log(Uniform())) * cos(2.*M_PI * Uniform());
+}
+
+static float Clamp01(float value){
+  return value < 0. ? 0. : (value > 1. ? 1. : value);
+}
+
+static double WallSeconds(){
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static Candidate MakeCandidate(const ControllerParams& base, const vector<int>& swept,
+			       const vector<float>& point){
+  Candidate candidate;
+  candidate.params = base;
+  candidate.point = point;
+  int dims = swept.size();
+  for(int d = 0; d < dims; d++){
+    const ParamRange& range = kRanges[swept[d]];
+    candidate.params.*range.field = range.low + point[d] * (range.high - range.low);
+  }
+  candidate.score = 0.;
+  candidate.convergedFraction = 0.;
+  return candidate;
+}
+
+// Scores a batch of candidates, all trials of all candidates in parallel
+static void Evaluate(vector<Candidate>& candidates, const TrialConfig& base,
+		     int trials, int threads){
+  int numCandidates = candidates.size();
+  vector<TrialConfig> configs;
+  configs.reserve(numCandidates * trials);
+  for(int c = 0; c < numCandidates; c++){
+    for(int k = 0; k < trials; k++){
+      TrialConfig config = base;
+      config.sim.controller = candidates[c].params;
+      config.sim.seed = base.sim.seed + k;
+      configs.push_back(config);
+    }
+  }
+
+  vector<TrialResult> results;
+  RunTrials(configs, results, threads);
+
+  for(int c = 0; c < numCandidates; c++){
+    double total = 0.;
+    int converged = 0;
+    for(int k = 0; k < trials; k++){
+      const TrialResult& result = results[c*trials + k];
+      total += result.convergenceTime;
+      if(result.converged)
+	converged++;
+    }
+    candidates[c].score = total / trials;
+    candidates[c].convergedFraction = converged / (float)trials;
+  }
+}
+
+//===========================================================================
+// Search strategies
+//===========================================================================
+static void GridSearch(vector<Candidate>& all, const ControllerParams& base,
+		       const vector<int>& swept, int levels){
+  int dims = swept.size();
+  int total = 1;
+  for(int d = 0; d < dims; d++)
+    total *= levels;
+
+  for(int i = 0; i < total; i++){
+    vector<float> point(dims);
+    int index = i;
+    for(int d = 0; d < dims; d++){
+      point[d] = levels > 1 ? (index % levels) / (float)(levels - 1) : 0.5;
+      index /= levels;
+    }
+    all.push_back(MakeCandidate(base, swept, point));
+  }
+}
+
+static void RandomSearch(vector<Candidate>& all, const ControllerParams& base,
+			 const vector<int>& swept, int candidates){
+  int dims = swept.size();
+  for(int i = 0; i < candidates; i++){
+    vector<float> point(dims);
+    for(int d = 0; d < dims; d++)
+      point[d] = Uniform();
+    all.push_back(MakeCandidate(base, swept, point));
+  }
+}
+
+// Separable (diagonal covariance) evolution strategy in the spirit of
+// CMA-ES: sample around the mean, recombine the best half with log weights
+// and adapt each dimension's step size from the selected steps.
+static void EvolutionSearch(vector<Candidate>& all, const ControllerParams& base,
+			    const vector<int>& swept, int generations, int population,
+			    const TrialConfig& trialConfig, int trials, int threads){
+  int dims = swept.size();
+  int parents = population / 2 > 1 ? population / 2 : 1;
+
+  vector<float> weights(parents);
+  float weightSum = 0.;
+  for(int i = 0; i < parents; i++){
+    weights[i] = log(parents + 0.5) - log(i + 1.);
+    weightSum += weights[i];
+  }
+  for(int i = 0; i < parents; i++)
+    weights[i] /= weightSum;
+
+  // Start from the current defaults
+  vector<float> mean(dims);
+  vector<float> sigma(dims, 0.3);
+  for(int d = 0; d < dims; d++){
+    const ParamRange& range = kRanges[swept[d]];
+    mean[d] = Clamp01((base.*range.field - range.low) / (range.high - range.low));
+  }
+  const float learningRate = 0.3;
+
+  for(int g = 0; g < generations; g++){
+    vector<Candidate> generation;
+    for(int i = 0; i < population; i++){
+      vector<float> point(dims);
+      for(int d = 0; d < dims; d++)
+	point[d] = Clamp01(mean[d] + sigma[d] * Gaussian());
+      generation.push_back(MakeCandidate(base, swept, point));
+    }
+
+    Evaluate(generation, trialConfig, trials, threads);
+    sort(generation.begin(), generation.end(), CandidateBetter);
+
+    vector<float> newMean(dims, 0.);
+    for(int i = 0; i < parents; i++)
+      for(int d = 0; d < dims; d++)
+	newMean[d] += weights[i] * generation[i].point[d];
+
+    for(int d = 0; d < dims; d++){
+      float spread = 0.;
+      for(int i = 0; i < parents; i++){
+	float step = generation[i].point[d] - mean[d];
+	spread += weights[i] * step * step;
+      }
+      sigma[d] = sqrt((1. - learningRate) * sigma[d] * sigma[d] + learningRate * spread);
+      if(sigma[d] < 0.01)
+	sigma[d] = 0.01;
+    }
+    mean = newMean;
+
+    printf("generation %2d: best %.2f s (converged %.0f%%) ", g + 1,
+	   generation[0].score, 100. * generation[0].convergedFraction);
+    PrintControllerParams(generation[0].params);
+
+    all.insert(all.end(), generation.begin(), generation.end());
+  }
+}
+
+//===========================================================================
+// Main Function
+//===========================================================================
+int main(int argc, char* argv[]){
+
+  TrialConfig trialConfig;
+  DefaultTrialConfig(trialConfig);
+  trialConfig.maxTime = 120.;
+
+  const char* mode = "random";
+  const char* paramList = "catchup-kp,impulse-kp,cruise,slow,reverse,align,evade";
+  const char* outPath = NULL;
+  int levels = 3;
+  int candidates = 64;
+  int generations = 10;
+  int population = 16;
+  int trials = 16;
+  int top = 10;
+  int threads = sysconf(_SC_NPROCESSORS_ONLN);
+
+  for(int i = 1; i < argc; i++){
+    if(strncmp(argv[i], "--mode=", 7) == 0)
+      mode = argv[i] + 7;
+    else if(strncmp(argv[i], "--params=", 9) == 0)
+      paramList = argv[i] + 9;
+    else if(strncmp(argv[i], "--levels=", 9) == 0)
+      levels = atoi(argv[i] + 9);
+    else if(strncmp(argv[i], "--candidates=", 13) == 0)
+      candidates = atoi(argv[i] + 13);
+    else if(strncmp(argv[i], "--generations=", 14) == 0)
+      generations = atoi(argv[i] + 14);
+    else if(strncmp(argv[i], "--population=", 13) == 0)
+      population = atoi(argv[i] + 13);
+    else if(strncmp(argv[i], "--trials=", 9) == 0)
+      trials = atoi(argv[i] + 9);
+    else if(strncmp(argv[i], "--robots=", 9) == 0)
+      trialConfig.sim.numRobots = atoi(argv[i] + 9);
+    else if(strncmp(argv[i], "--max-time=", 11) == 0)
+      trialConfig.maxTime = atof(argv[i] + 11);
+    else if(strncmp(argv[i], "--seed=", 7) == 0)
+      trialConfig.sim.seed = strtoul(argv[i] + 7, NULL, 10);
+    else if(strncmp(argv[i], "--threads=", 10) == 0)
+      threads = atoi(argv[i] + 10);
+    else if(strncmp(argv[i], "--top=", 6) == 0)
+      top = atoi(argv[i] + 6);
+    else if(strncmp(argv[i], "--out=", 6) == 0)
+      outPath = argv[i] + 6;
+    else if(ParseControllerParam(argv[i], trialConfig.sim.controller))
+      continue;
+    else{
+      printf("Unknown option %s\n", argv[i]);
+      return 1;
+    }
+  }
+
+  // Which parameters to sweep
+  vector<int> swept;
+  for(int r = 0; r < kNumRanges; r++)
+    if(ListHasName(paramList, kRanges[r].name))
+      swept.push_back(r);
+  if(swept.empty()){
+    printf("No known parameters in --params=%s\n", paramList);
+    return 1;
+  }
+
+  randomState = trialConfig.sim.seed * 2654435761u + 1;
+  const ControllerParams& base = trialConfig.sim.controller;
+
+  // The defaults are always scored so the ranking shows the improvement
+  vector<Candidate> all;
+  Candidate baseline = MakeCandidate(base, vector<int>(), vector<float>());
+
+  double start = WallSeconds();
+  if(strcmp(mode, "grid") == 0){
+    GridSearch(all, base, swept, levels);
+    Evaluate(all, trialConfig, trials, threads);
+  }
+  else if(strcmp(mode, "random") == 0){
+    RandomSearch(all, base, swept, candidates);
+    Evaluate(all, trialConfig, trials, threads);
+  }
+  else if(strcmp(mode, "cmaes") == 0){
+    EvolutionSearch(all, base, swept, generations, population,
+		    trialConfig, trials, threads);
+  }
+  else{
+    printf("Unknown mode %s\n", mode);
+    return 1;
+  }
+
+  vector<Candidate> baselineBatch(1, baseline);
+  Evaluate(baselineBatch, trialConfig, trials, threads);
+  baseline = baselineBatch[0];
+  double elapsed = WallSeconds() - start;
+
+  sort(all.begin(), all.end(), CandidateBetter);
+  int numCandidates = all.size();
+
+  printf("%s search: %d candidates x %d trials of %d robots in %.1f s\n", mode,
+	 numCandidates, trials, trialConfig.sim.numRobots, elapsed);
+  printf("baseline  %7.2f s (converged %3.0f%%) ", baseline.score,
+	 100. * baseline.convergedFraction);
+  PrintControllerParams(baseline.params);
+  for(int i = 0; i < top and i < numCandidates; i++){
+    printf("#%-3d      %7.2f s (converged %3.0f%%) ", i + 1, all[i].score,
+	   100. * all[i].convergedFraction);
+    PrintControllerParams(all[i].params);
+  }
+
+  if(outPath != NULL){
+    ResultsTable table;
+    int columns[kNumRanges];
+    for(int r = 0; r < kNumRanges; r++)
+      columns[r] = table.AddFloatColumn(kRanges[r].name);
+    int scoreColumn = table.AddFloatColumn("mean_formation_time");
+    int convergedColumn = table.AddFloatColumn("converged_fraction");
+
+    for(int i = 0; i < numCandidates; i++){
+      int row = table.AddRow();
+      for(int r = 0; r < kNumRanges; r++)
+	table.SetFloat(columns[r], row, all[i].params.*kRanges[r].field);
+      table.SetFloat(scoreColumn, row, all[i].score);
+      table.SetFloat(convergedColumn, row, all[i].convergedFraction);
+    }
+    if(table.Write(outPath))
+      printf("Ranked candidates written to %s\n", outPath);
+  }
+
+  return 0;
+}
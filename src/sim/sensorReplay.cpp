@@ -0,0 +1,228 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include <stdint.h>
+
+#include "../BotController.h"
+#include "../SensorLog.h"
+#include "../LatencyHistogram.h"
+
+using namespace std;
+
+//===========================================================================
+// Sensor recording replay
+//
+//   botSensorReplay file.rec [--realtime] [--repeat=N] [--show-mismatches=M]
+//                   [controller parameters, see ControllerParams.h]
+//
+// Feeds a recording made with the node's --record (or botSwarmSim --record)
+// through a fresh BotController, running a control tick wherever the
+// original loop did. By default records are replayed as fast as possible,
+// which makes a repeatable throughput benchmark of decode plus tick;
+// --realtime keeps the original spacing of the receive times instead.
+//
+// Every tick's wheel speeds and stimuli are compared with the recorded
+// ones, so a replay with the same parameters doubles as a regression check.
+//===========================================================================
+
+struct ReplayStats{
+  unsigned long records[SENSOR_RECORD_TYPE_COUNT];
+  unsigned long ticks;
+  unsigned long mismatches;
+  LatencyHistogram tickTime;
+};
+
+static uint64_t Nanoseconds(){
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+static void SleepUntil(uint64_t deadline){
+  struct timespec ts;
+  ts.tv_sec = deadline / 1000000000ull;
+  ts.tv_nsec = deadline % 1000000000ull;
+  while(clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL) != 0)
+    ;
+}
+
+static bool SameSpeed(float a, float b){
+  return fabs(a - b) <= 1e-4 * (1. + fabs(b));
+}
+
+// The same checks and calls as the node's callbacks
+static void Dispatch(BotController& controller, const SensorRecordHeader& header,
+		     const unsigned char* payload){
+  switch(header.type){
+  case SENSOR_RECORD_INFO:{
+    float simulationTime;
+    memcpy(&simulationTime, payload, sizeof(simulationTime));
+    controller.SetSimulationTime(simulationTime);
+    break;
+  }
+  case SENSOR_RECORD_FRONT_PROX:
+    controller.FrontProximity();
+    break;
+  case SENSOR_RECORD_REAR_PROX:
+    controller.RearProximity();
+    break;
+  case SENSOR_RECORD_OMNI_FRONT:
+  case SENSOR_RECORD_OMNI_BACK:
+  case SENSOR_RECORD_OMNI_RIGHT:
+  case SENSOR_RECORD_OMNI_LEFT:{
+    int packetLength = header.length / sizeof(float);
+    if(header.count < 1 or packetLength < 2)
+      break;
+    // Payloads are 8 byte aligned within the mapping
+    controller.OmniPacket(header.type - SENSOR_RECORD_OMNI_FRONT,
+			  (const float*)payload, packetLength);
+    break;
+  }
+  case SENSOR_RECORD_POSE:{
+    double yaw;
+    memcpy(&yaw, payload, sizeof(yaw));
+    controller.BodyOrientation(yaw);
+    break;
+  }
+  default:
+    // The puck cameras are recorded but not used by the formation states
+    break;
+  }
+}
+
+static void CheckTick(BotController& controller, const unsigned char* payload,
+		      uint32_t length, ReplayStats& stats, unsigned long showMismatches){
+  // Older recordings have a shorter tick; what they lack reads as zero
+  SensorTickRecord recorded;
+  memset(&recorded, 0, sizeof(recorded));
+  memcpy(&recorded, payload, length < sizeof(recorded) ? length : sizeof(recorded));
+
+  bool match = SameSpeed(controller.GetLeftMotorSpeed(), recorded.leftMotorSpeed) and
+    SameSpeed(controller.GetRightMotorSpeed(), recorded.rightMotorSpeed) and
+    controller.GetServoOpen() == (recorded.servoOpen != 0);
+  for(int i = 0; i < kNumStimuli; i++)
+    match = match and controller.GetStimulus(i) == (recorded.stimuli[i] != 0);
+
+  if(match)
+    return;
+
+  stats.mismatches++;
+  if(stats.mismatches <= showMismatches)
+    printf("tick %lu: wheels %.4f %.4f, recorded %.4f %.4f (%s)\n", stats.ticks,
+	   controller.GetLeftMotorSpeed(), controller.GetRightMotorSpeed(),
+	   recorded.leftMotorSpeed, recorded.rightMotorSpeed,
+	   controller.GetStateManager()->GetCurrentStateName().c_str());
+}
+
+static void Replay(SensorLogReader& reader, const ControllerParams& params, bool realtime,
+		   unsigned long showMismatches, ReplayStats& stats){
+  BotController controller(params);
+
+  SensorRecordHeader header;
+  const unsigned char* payload;
+  uint64_t firstReceive = 0;
+  uint64_t start = Nanoseconds();
+  bool first = true;
+
+  reader.Rewind();
+  while(reader.Next(header, payload)){
+    if(header.type >= SENSOR_RECORD_TYPE_COUNT)
+      continue;
+    stats.records[header.type]++;
+
+    if(realtime){
+      if(first)
+	firstReceive = header.receiveNs;
+      else if(header.receiveNs > firstReceive)
+	SleepUntil(start + (header.receiveNs - firstReceive));
+      first = false;
+    }
+
+    if(header.type != SENSOR_RECORD_TICK){
+      Dispatch(controller, header, payload);
+      continue;
+    }
+
+    // Same order as the node's control loop
+    uint64_t tickStart = Nanoseconds();
+    controller.FuseSensors();
+    controller.UpdateBehaviour();
+    controller.ExecuteBehaviour();
+    stats.tickTime.Record(Nanoseconds() - tickStart);
+
+    CheckTick(controller, payload, header.length, stats, showMismatches);
+    controller.ClearProximity();
+    stats.ticks++;
+  }
+}
+
+//===========================================================================
+// Main Function
+//===========================================================================
+int main(int argc, char* argv[]){
+
+  if(argc < 2 or argv[1][0] == '-'){
+    printf("Usage: %s file.rec [--realtime] [--repeat=N] [--show-mismatches=M]"
+	   " [controller parameters]\n", argv[0]);
+    return 1;
+  }
+
+  ControllerParams params;
+  DefaultControllerParams(params);
+  bool realtime = false;
+  int repeat = 1;
+  unsigned long showMismatches = 10;
+
+  for(int i = 2; i < argc; i++){
+    if(strcmp(argv[i], "--realtime") == 0)
+      realtime = true;
+    else if(strncmp(argv[i], "--repeat=", 9) == 0)
+      repeat = atoi(argv[i] + 9);
+    else if(strncmp(argv[i], "--show-mismatches=", 18) == 0){
+      int show = atoi(argv[i] + 18);
+      showMismatches = show > 0 ? show : 0;
+    }
+    else if(ParseControllerParam(argv[i], params))
+      continue;
+    else{
+      printf("Unknown option %s\n", argv[i]);
+      return 1;
+    }
+  }
+
+  SensorLogReader reader;
+  if(not reader.Open(argv[1]))
+    return 1;
+
+  ReplayStats stats;
+  memset(stats.records, 0, sizeof(stats.records));
+  stats.ticks = 0;
+  stats.mismatches = 0;
+
+  uint64_t start = Nanoseconds();
+  for(int r = 0; r < repeat; r++)
+    Replay(reader, params, realtime, r == 0 ? showMismatches : 0, stats);
+  double elapsed = (Nanoseconds() - start) * 1e-9;
+
+  unsigned long totalRecords = 0;
+  printf("%s: %.1f kB, replayed %d time(s)%s\n", argv[1], reader.GetSize() / 1024.,
+	 repeat, realtime ? " at the recorded pace" : "");
+  for(int t = 0; t < SENSOR_RECORD_TYPE_COUNT; t++){
+    totalRecords += stats.records[t];
+    if(stats.records[t] > 0)
+      printf("  %-10s %10lu\n", SensorRecordTypeName(t), stats.records[t]);
+  }
+  printf("%lu records, %lu ticks in %.3f s: %.0f records/s, %.0f ticks/s, %.1f MB/s\n",
+	 totalRecords, stats.ticks, elapsed, totalRecords / elapsed, stats.ticks / elapsed,
+	 repeat * reader.GetSize() / elapsed / 1e6);
+  stats.tickTime.Print(stdout, "Tick");
+
+  if(stats.ticks == 0){
+    printf("No ticks in the recording\n");
+    return 1;
+  }
+  printf("%lu of %lu ticks differ from the recording\n", stats.mismatches, stats.ticks);
+  return stats.mismatches == 0 ? 0 : 2;
+}
@@ -0,0 +1,147 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <math.h>
+#include <map>
+#include <string>
+
+#include "SwarmSim.h"
+
+using namespace std;
+
+//===========================================================================
+// Headless swarm simulator
+//
+//   botSwarmSim [--robots=N] [--steps=S] [--seed=X] [--dt=T] [--spawn=W]
+//               [--ticks-per-frame=F] [--print-every=K] [--brute-force]
+//               [--record=file] [--record-robot=I]
+//               [controller parameters, see ControllerParams.h]
+//   botSwarmSim --bench-grid
+//
+// Runs the real BotController/StateManager for every robot against the
+// kinematic model in SwarmSim and reports the achieved step rate.
+// --bench-grid compares the spatial grid with the all pairs scan for
+// growing swarms at constant density. --record writes the inputs of one
+// robot (default 0) as a sensor recording for botSensorReplay.
+//===========================================================================
+
+static double WallSeconds(){
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static void PrintStateCounts(SwarmSim& sim){
+  map<string, int> counts;
+  for(int i = 0; i < sim.GetNumRobots(); i++)
+    counts[sim.GetRobot(i).controller->GetStateManager()->GetCurrentStateName()]++;
+
+  printf("t = %7.2f s:", sim.GetTime());
+  for(map<string, int>::iterator it = counts.begin(); it != counts.end(); ++it)
+    printf(" %s=%d", it->first.c_str(), it->second);
+  printf("\n");
+}
+
+static double TimeSteps(SwarmSimConfig config, int steps){
+  SwarmSim sim(config);
+  sim.Step();
+
+  double start = WallSeconds();
+  for(int step = 0; step < steps; step++)
+    sim.Step();
+  return (WallSeconds() - start) / steps;
+}
+
+static void BenchmarkGrid(){
+  int sizes[] = {1000, 2000, 5000, 10000};
+
+  printf("%8s %14s %14s %12s %12s\n", "robots", "grid ms/step", "brute ms/step",
+	 "grid us/bot", "speedup");
+  for(int i = 0; i < 4; i++){
+    SwarmSimConfig config;
+    DefaultSwarmSimConfig(config);
+    config.numRobots = sizes[i];
+    // Keep roughly the same number of robots in camera range as N grows
+    config.spawnSize = 0.6 * sqrt((double)sizes[i]);
+
+    config.useSpatialGrid = true;
+    double grid = TimeSteps(config, 20);
+    config.useSpatialGrid = false;
+    double brute = TimeSteps(config, sizes[i] > 2000 ? 2 : 5);
+
+    printf("%8d %14.3f %14.3f %12.3f %11.1fx\n", sizes[i], grid*1e3, brute*1e3,
+	   grid*1e6 / sizes[i], brute / grid);
+  }
+}
+
+int main(int argc, char* argv[]){
+
+  SwarmSimConfig config;
+  DefaultSwarmSimConfig(config);
+
+  int steps = 10000;
+  int printEvery = 0;
+  const char* recordPath = NULL;
+  int recordRobot = 0;
+
+  for(int i = 1; i < argc; i++){
+    if(strncmp(argv[i], "--robots=", 9) == 0)
+      config.numRobots = atoi(argv[i] + 9);
+    else if(strncmp(argv[i], "--steps=", 8) == 0)
+      steps = atoi(argv[i] + 8);
+    else if(strncmp(argv[i], "--seed=", 7) == 0)
+      config.seed = strtoul(argv[i] + 7, NULL, 10);
+    else if(strncmp(argv[i], "--dt=", 5) == 0)
+      config.dt = atof(argv[i] + 5);
+    else if(strncmp(argv[i], "--ticks-per-frame=", 18) == 0)
+      config.ticksPerFrame = atoi(argv[i] + 18);
+    else if(strncmp(argv[i], "--spawn=", 8) == 0)
+      config.spawnSize = atof(argv[i] + 8);
+    else if(strncmp(argv[i], "--print-every=", 14) == 0)
+      printEvery = atoi(argv[i] + 14);
+    else if(strncmp(argv[i], "--record=", 9) == 0)
+      recordPath = argv[i] + 9;
+    else if(strncmp(argv[i], "--record-robot=", 15) == 0)
+      recordRobot = atoi(argv[i] + 15);
+    else if(ParseControllerParam(argv[i], config.controller))
+      continue;
+    else if(strcmp(argv[i], "--brute-force") == 0)
+      config.useSpatialGrid = false;
+    else if(strcmp(argv[i], "--bench-grid") == 0){
+      BenchmarkGrid();
+      return 0;
+    }
+    else{
+      printf("Unknown option %s\n", argv[i]);
+      return 1;
+    }
+  }
+
+  SwarmSim sim(config);
+
+  SensorRecorder recorder;
+  if(recordPath != NULL){
+    if(recordRobot < 0 or recordRobot >= config.numRobots or not recorder.Open(recordPath))
+      return 1;
+    sim.SetRecorder(&recorder, recordRobot);
+  }
+
+  double start = WallSeconds();
+  for(int step = 0; step < steps; step++){
+    sim.Step();
+    if(printEvery > 0 and (step + 1) % printEvery == 0)
+      PrintStateCounts(sim);
+  }
+  double elapsed = WallSeconds() - start;
+
+  PrintStateCounts(sim);
+  printf("%d robots, %d steps in %.3f s: %.0f steps/s, %.0f controller ticks/s\n",
+	 config.numRobots, steps, elapsed, steps / elapsed,
+	 (double)steps * config.numRobots / elapsed);
+  if(recorder.IsOpen())
+    printf("Recorded %lu records of robot %d to %s\n", recorder.GetRecordCount(),
+	   recordRobot, recordPath);
+
+  return 0;
+}
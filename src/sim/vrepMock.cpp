@@ -0,0 +1,544 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/wait.h>
+#include <string>
+#include <vector>
+
+// ROS includes
+#include <ros/ros.h>
+#include <geometry_msgs/PoseStamped.h>
+
+// Include for V-REP
+#include "../../include/v_repConst.h"
+#include "vrep_common/ProximitySensorData.h"
+#include "vrep_common/VrepInfo.h"
+#include "vrep_common/JointSetStateData.h"
+#include "vrep_common/VisionSensorData.h"
+#include "vrep_common/simRosEnablePublisher.h"
+#include "vrep_common/simRosEnableSubscriber.h"
+#include "vrep_common/simRosAuxiliaryConsolePrint.h"
+
+#include "SwarmSim.h"
+#include "../SensorLog.h"
+#include "../LatencyHistogram.h"
+
+using namespace std;
+
+//===========================================================================
+// Local stand-in for V-REP
+//
+//   botVrepMock [--source=file.rec | --robots=N --steps=S --seed=X]
+//               [--rate=HZ] [--info-rate=HZ] [--frames=N] [--loop]
+//               [--wait=SECONDS] [--spawn=path/to/botPatternFormation
+//               [-- extra controller flags]]
+//
+// Serves the simRosEnablePublisher, simRosEnableSubscriber and
+// simRosAuxiliaryConsolePrint services the node calls at start up,
+// publishes /vrep/info and the sensor topics it asks for, and measures the
+// wheel commands and console output that come back.
+//
+// Sensor frames come from a sensor recording (see SensorLog.h), one frame
+// being the records between two tick markers. Without --source a recording
+// of robot 0 is generated with the swarm simulator first. The scene is open
+// loop: the wheel commands are measured, not fed back into the frames.
+//
+// With --spawn the controller is started with the handles below, so start
+// up (node creation, service calls, first wheel command) is timed as well.
+// Otherwise the command line to start it by hand is printed.
+//===========================================================================
+
+// Object handles, in the order botPatternFormation takes them
+enum MockHandle{
+  HANDLE_LEFT_MOTOR = 1,
+  HANDLE_RIGHT_MOTOR,
+  HANDLE_SERVO,
+  HANDLE_FRONT_PROX,
+  HANDLE_REAR_PROX,
+  HANDLE_CAMERA_RED,
+  HANDLE_CAMERA_BLUE,
+  HANDLE_CONSOLE,
+  HANDLE_BODY,
+  HANDLE_OMNI_FRONT,
+  HANDLE_OMNI_BACK,
+  HANDLE_OMNI_RIGHT,
+  HANDLE_OMNI_LEFT,
+  HANDLE_COUNT
+};
+
+// Topics the node requests: two proximity sensors, two puck cameras, four
+// omni segments, the body pose, and the wheel and servo subscriptions.
+static const int kExpectedPublishers = 9;
+static const int kExpectedSubscribers = 2;
+
+struct MockStats{
+  uint64_t startNs;
+  uint64_t firstRequestNs;
+  uint64_t allRequestedNs;
+  uint64_t firstWheelNs;
+  uint64_t firstConsoleNs;
+
+  int publisherRequests;
+  int subscriberRequests;
+
+  unsigned long frames;
+  unsigned long wheelMessages;
+  unsigned long servoMessages;
+  unsigned long consoleMessages;
+  unsigned long consoleBytes;
+
+  float lastLeft;
+  float lastRight;
+  float lastServo;
+
+  // First wheel command after each frame
+  bool frameAwaitingWheel;
+  uint64_t framePublishedNs;
+  LatencyHistogram frameToWheel;
+  LatencyHistogram wheelPeriod;
+  uint64_t lastWheelNs;
+};
+
+// Global variables (used by the service and topic callbacks), zero
+// initialised:
+ros::NodeHandle* mockNode = NULL;
+ros::Publisher sensorPublishers[SENSOR_RECORD_TYPE_COUNT];
+bool sensorEnabled[SENSOR_RECORD_TYPE_COUNT];
+vector<ros::Subscriber> actuatorSubscribers;
+MockStats stats;
+
+//===========================================================================
+// Helper Functions
+//===========================================================================
+static uint64_t Nanoseconds(){
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+static double SinceStart(uint64_t ns){
+  return ns == 0 ? -1. : (ns - stats.startNs) * 1e-6;
+}
+
+static int HandleRecordType(int handle){
+  switch(handle){
+  case HANDLE_FRONT_PROX: return SENSOR_RECORD_FRONT_PROX;
+  case HANDLE_REAR_PROX: return SENSOR_RECORD_REAR_PROX;
+  case HANDLE_CAMERA_RED: return SENSOR_RECORD_CAMERA_RED;
+  case HANDLE_CAMERA_BLUE: return SENSOR_RECORD_CAMERA_BLUE;
+  case HANDLE_BODY: return SENSOR_RECORD_POSE;
+  case HANDLE_OMNI_FRONT: return SENSOR_RECORD_OMNI_FRONT;
+  case HANDLE_OMNI_BACK: return SENSOR_RECORD_OMNI_BACK;
+  case HANDLE_OMNI_RIGHT: return SENSOR_RECORD_OMNI_RIGHT;
+  case HANDLE_OMNI_LEFT: return SENSOR_RECORD_OMNI_LEFT;
+  default: return -1;
+  }
+}
+
+static bool EndsWith(const string& text, const char* suffix){
+  int length = strlen(suffix);
+  return text.size() >= length and text.compare(text.size() - length, length, suffix) == 0;
+}
+
+static void NoteRequest(){
+  uint64_t now = Nanoseconds();
+  if(stats.firstRequestNs == 0)
+    stats.firstRequestNs = now;
+  if(stats.allRequestedNs == 0 and stats.publisherRequests >= kExpectedPublishers
+     and stats.subscriberRequests >= kExpectedSubscribers)
+    stats.allRequestedNs = now;
+}
+
+// Runs the swarm simulator and records robot 0, used when no --source is given
+static bool GenerateRecording(const char* path, int robots, int steps, unsigned int seed){
+  SwarmSimConfig config;
+  DefaultSwarmSimConfig(config);
+  config.numRobots = robots;
+  config.seed = seed;
+
+  SensorRecorder recorder;
+  if(not recorder.Open(path))
+    return false;
+
+  SwarmSim sim(config);
+  sim.SetRecorder(&recorder, 0);
+  for(int step = 0; step < steps; step++)
+    sim.Step();
+  recorder.Close();
+
+  printf("Generated %d frames of %d robots (seed %u)\n", steps, robots, seed);
+  return true;
+}
+
+static pid_t SpawnController(const char* path, char** extraArgs, int extraCount){
+  vector<char*> args;
+  char handles[HANDLE_COUNT][8];
+
+  args.push_back((char*)path);
+  for(int h = HANDLE_LEFT_MOTOR; h < HANDLE_COUNT; h++){
+    snprintf(handles[h], sizeof(handles[h]), "%d", h);
+    args.push_back(handles[h]);
+  }
+  for(int i = 0; i < extraCount; i++)
+    args.push_back(extraArgs[i]);
+  args.push_back(NULL);
+
+  pid_t pid = fork();
+  if(pid == 0){
+    execv(path, &args[0]);
+    printf("Could not start %s\n", path);
+    _exit(127);
+  }
+  return pid;
+}
+
+static void PublishInfo(const ros::Publisher& infoPublisher, float simulationTime, bool running){
+  vrep_common::VrepInfo info;
+  info.headerInfo.stamp = ros::Time::now();
+  info.simulatorState.data = running ? 1 : 0;
+  info.simulationTime.data = simulationTime;
+  info.timeStep.data = 0.05;
+  infoPublisher.publish(info);
+}
+
+//===========================================================================
+// Service callbacks
+//===========================================================================
+bool EnablePublisherService(vrep_common::simRosEnablePublisher::Request& request,
+			    vrep_common::simRosEnablePublisher::Response& response){
+  int type = HandleRecordType(request.auxInt1);
+  response.effectiveTopicName = "/vrep/" + request.topicName;
+
+  if(type < 0){
+    printf("Publisher requested for unknown handle %d\n", request.auxInt1);
+    return true;
+  }
+
+  if(request.streamCmd == simros_strmcmd_read_proximity_sensor)
+    sensorPublishers[type] =
+      mockNode->advertise<vrep_common::ProximitySensorData>(request.topicName, request.queueSize);
+  else if(request.streamCmd == simros_strmcmd_read_vision_sensor)
+    sensorPublishers[type] =
+      mockNode->advertise<vrep_common::VisionSensorData>(request.topicName, request.queueSize);
+  else if(request.streamCmd == simros_strmcmd_get_object_pose)
+    sensorPublishers[type] =
+      mockNode->advertise<geometry_msgs::PoseStamped>(request.topicName, request.queueSize);
+  else{
+    printf("Unsupported stream command %d for %s\n", request.streamCmd, request.topicName.c_str());
+    return true;
+  }
+
+  sensorEnabled[type] = true;
+  stats.publisherRequests++;
+  NoteRequest();
+  return true;
+}
+
+void WheelCallback(const vrep_common::JointSetStateData::ConstPtr& msg){
+  uint64_t now = Nanoseconds();
+  if(stats.firstWheelNs == 0)
+    stats.firstWheelNs = now;
+  if(stats.lastWheelNs != 0)
+    stats.wheelPeriod.Record(now - stats.lastWheelNs);
+  stats.lastWheelNs = now;
+
+  if(stats.frameAwaitingWheel){
+    stats.frameToWheel.Record(now - stats.framePublishedNs);
+    stats.frameAwaitingWheel = false;
+  }
+
+  if(msg->values.data.size() >= 2){
+    stats.lastLeft = msg->values.data[0];
+    stats.lastRight = msg->values.data[1];
+  }
+  stats.wheelMessages++;
+}
+
+void ServoCallback(const vrep_common::JointSetStateData::ConstPtr& msg){
+  if(msg->values.data.size() >= 1)
+    stats.lastServo = msg->values.data[0];
+  stats.servoMessages++;
+}
+
+bool EnableSubscriberService(vrep_common::simRosEnableSubscriber::Request& request,
+			     vrep_common::simRosEnableSubscriber::Response& response){
+  if(EndsWith(request.topicName, "/wheels"))
+    actuatorSubscribers.push_back(mockNode->subscribe(request.topicName, 1, WheelCallback));
+  else if(EndsWith(request.topicName, "/servo"))
+    actuatorSubscribers.push_back(mockNode->subscribe(request.topicName, 1, ServoCallback));
+  else
+    printf("Subscriber requested for unknown topic %s\n", request.topicName.c_str());
+
+  stats.subscriberRequests++;
+  response.subscriberID = stats.subscriberRequests;
+  NoteRequest();
+  return true;
+}
+
+bool ConsolePrintService(vrep_common::simRosAuxiliaryConsolePrint::Request& request,
+			 vrep_common::simRosAuxiliaryConsolePrint::Response& response){
+  if(stats.firstConsoleNs == 0)
+    stats.firstConsoleNs = Nanoseconds();
+  stats.consoleMessages++;
+  stats.consoleBytes += request.text.size();
+  response.result = 1;
+  return true;
+}
+
+//===========================================================================
+// Sensor frames
+//===========================================================================
+
+// Publishes the records up to the next tick marker. Returns false at the end
+// of the recording.
+static bool PublishFrame(SensorLogReader& reader, float& simulationTime){
+  SensorRecordHeader header;
+  const unsigned char* payload;
+  ros::Time stamp = ros::Time::now();
+
+  while(reader.Next(header, payload)){
+    if(header.type == SENSOR_RECORD_TICK){
+      stats.framePublishedNs = Nanoseconds();
+      stats.frameAwaitingWheel = true;
+      stats.frames++;
+      return true;
+    }
+
+    if(header.type == SENSOR_RECORD_INFO){
+      memcpy(&simulationTime, payload, sizeof(simulationTime));
+      continue;
+    }
+
+    if(header.type >= SENSOR_RECORD_TYPE_COUNT or not sensorEnabled[header.type])
+      continue;
+
+    if(header.type == SENSOR_RECORD_FRONT_PROX or header.type == SENSOR_RECORD_REAR_PROX){
+      vrep_common::ProximitySensorData prox;
+      prox.header.stamp = stamp;
+      sensorPublishers[header.type].publish(prox);
+    }
+    else if(header.type == SENSOR_RECORD_POSE){
+      double yaw;
+      memcpy(&yaw, payload, sizeof(yaw));
+      geometry_msgs::PoseStamped pose;
+      pose.header.stamp = stamp;
+      pose.pose.orientation.x = 0.;
+      pose.pose.orientation.y = 0.;
+      pose.pose.orientation.z = sin(yaw / 2.);
+      pose.pose.orientation.w = cos(yaw / 2.);
+      sensorPublishers[header.type].publish(pose);
+    }
+    else{
+      const float* packetData = (const float*)payload;
+      vrep_common::VisionSensorData vision;
+      vision.header.stamp = stamp;
+      vision.packetSizes.data.assign(header.count, 0);
+      vision.packetData.data.assign(packetData, packetData + header.length / sizeof(float));
+      sensorPublishers[header.type].publish(vision);
+    }
+  }
+  return false;
+}
+
+static void PrintReport(double elapsed){
+  printf("Start up (ms since the mock was ready):\n");
+  printf("  first service call  %9.1f\n", SinceStart(stats.firstRequestNs));
+  printf("  all topics set up   %9.1f  (%d/%d publishers, %d/%d subscribers)\n",
+	 SinceStart(stats.allRequestedNs), stats.publisherRequests, kExpectedPublishers,
+	 stats.subscriberRequests, kExpectedSubscribers);
+  printf("  first wheel command %9.1f\n", SinceStart(stats.firstWheelNs));
+  printf("  first console print %9.1f\n", SinceStart(stats.firstConsoleNs));
+
+  printf("%lu frames in %.2f s, controller sent %lu wheel, %lu servo and %lu console"
+	 " messages (%.1f kB)\n", stats.frames, elapsed, stats.wheelMessages,
+	 stats.servoMessages, stats.consoleMessages, stats.consoleBytes / 1024.);
+  printf("  wheel commands %.0f/s, last left=%.3f right=%.3f servo=%.3f\n",
+	 stats.wheelMessages / elapsed, stats.lastLeft, stats.lastRight, stats.lastServo);
+  stats.frameToWheel.Print(stdout, "Frame to wheel");
+  stats.wheelPeriod.Print(stdout, "Wheel period");
+}
+
+//===========================================================================
+// Main Function
+//===========================================================================
+int main(int argc, char* argv[]){
+
+  const char* sourcePath = NULL;
+  const char* spawnPath = NULL;
+  char** spawnArgs = NULL;
+  int spawnArgCount = 0;
+  int robots = 10;
+  int steps = 2000;
+  unsigned int seed = 1;
+  float rate = 20.;
+  float infoRate = 0.;
+  long maxFrames = 0;
+  bool loop = false;
+  float waitSeconds = 10.;
+
+  for(int i = 1; i < argc; i++){
+    if(strcmp(argv[i], "--") == 0){
+      spawnArgs = argv + i + 1;
+      spawnArgCount = argc - i - 1;
+      break;
+    }
+    else if(strncmp(argv[i], "--source=", 9) == 0)
+      sourcePath = argv[i] + 9;
+    else if(strncmp(argv[i], "--robots=", 9) == 0)
+      robots = atoi(argv[i] + 9);
+    else if(strncmp(argv[i], "--steps=", 8) == 0)
+      steps = atoi(argv[i] + 8);
+    else if(strncmp(argv[i], "--seed=", 7) == 0)
+      seed = strtoul(argv[i] + 7, NULL, 10);
+    else if(strncmp(argv[i], "--rate=", 7) == 0)
+      rate = atof(argv[i] + 7);
+    else if(strncmp(argv[i], "--info-rate=", 12) == 0)
+      infoRate = atof(argv[i] + 12);
+    else if(strncmp(argv[i], "--frames=", 9) == 0)
+      maxFrames = atol(argv[i] + 9);
+    else if(strcmp(argv[i], "--loop") == 0)
+      loop = true;
+    else if(strncmp(argv[i], "--wait=", 7) == 0)
+      waitSeconds = atof(argv[i] + 7);
+    else if(strncmp(argv[i], "--spawn=", 8) == 0)
+      spawnPath = argv[i] + 8;
+    else{
+      printf("Unknown option %s\n", argv[i]);
+      return 1;
+    }
+  }
+  if(rate <= 0.)
+    rate = 20.;
+  if(infoRate <= 0.)
+    infoRate = rate;
+
+  // Sensor frames
+  //===========================================================================
+  char generatedPath[64];
+  if(sourcePath == NULL){
+    snprintf(generatedPath, sizeof(generatedPath), "/tmp/botVrepMock.%d.rec", (int)getpid());
+    if(not GenerateRecording(generatedPath, robots, steps, seed))
+      return 1;
+    sourcePath = generatedPath;
+  }
+
+  SensorLogReader reader;
+  bool opened = reader.Open(sourcePath);
+  if(sourcePath == generatedPath)
+    unlink(generatedPath);  // the mapping stays valid
+  if(not opened)
+    return 1;
+  //===========================================================================
+
+  // Stand in for the vrep node and its services
+  //===========================================================================
+  ros::init(argc, argv, "vrep", ros::init_options::NoSigintHandler);
+  if(!ros::master::check()){
+    printf("ROS check failure...exiting\n");
+    return 1;
+  }
+  ros::NodeHandle node("~");
+  mockNode = &node;
+
+  ros::ServiceServer enablePublisherServer =
+    node.advertiseService("simRosEnablePublisher", EnablePublisherService);
+  ros::ServiceServer enableSubscriberServer =
+    node.advertiseService("simRosEnableSubscriber", EnableSubscriberService);
+  ros::ServiceServer consolePrintServer =
+    node.advertiseService("simRosAuxiliaryConsolePrint", ConsolePrintService);
+  ros::Publisher infoPublisher = node.advertise<vrep_common::VrepInfo>("info", 1);
+  //===========================================================================
+
+  stats.startNs = Nanoseconds();
+  pid_t controllerPid = -1;
+  if(spawnPath != NULL){
+    controllerPid = SpawnController(spawnPath, spawnArgs, spawnArgCount);
+  }
+  else{
+    printf("botVrepMock ready, start the controller with:\n  botPatternFormation");
+    for(int h = HANDLE_LEFT_MOTOR; h < HANDLE_COUNT; h++)
+      printf(" %d", h);
+    printf("\n");
+  }
+
+  uint64_t framePeriod = 1e9 / rate;
+  uint64_t infoPeriod = 1e9 / infoRate;
+  uint64_t nextInfo = Nanoseconds();
+  uint64_t nextFrame = nextInfo;
+  float simulationTime = 0.;
+
+  // Keep the simulation "running" until the controller has asked for all of
+  // its topics, then stream the frames
+  uint64_t waitDeadline = stats.startNs + (uint64_t)(waitSeconds * 1e9);
+  bool streaming = false;
+  uint64_t streamStart = 0;
+
+  while(ros::ok()){
+    uint64_t now = Nanoseconds();
+
+    if(not streaming){
+      if(stats.allRequestedNs != 0){
+	streaming = true;
+	streamStart = now;
+	nextFrame = now;
+      }
+      else if(now > waitDeadline){
+	printf("Controller did not set up its topics within %.1f s\n", waitSeconds);
+	break;
+      }
+    }
+
+    if(now >= nextInfo){
+      PublishInfo(infoPublisher, simulationTime, true);
+      nextInfo += infoPeriod;
+    }
+
+    if(streaming and now >= nextFrame){
+      if(not PublishFrame(reader, simulationTime)){
+	if(not loop or stats.frames == 0)
+	  break;
+	reader.Rewind();
+      }
+      nextFrame += framePeriod;
+      if(maxFrames > 0 and stats.frames >= maxFrames)
+	break;
+    }
+
+    ros::spinOnce();
+
+    // Callbacks are served in between, so never sleep longer than a ms
+    uint64_t next = (nextInfo < nextFrame or not streaming) ? nextInfo : nextFrame;
+    now = Nanoseconds();
+    if(next > now){
+      uint64_t pause = next - now < 1000000 ? next - now : 1000000;
+      struct timespec ts = {0, (long)pause};
+      nanosleep(&ts, NULL);
+    }
+  }
+  double elapsed = streaming ? (Nanoseconds() - streamStart) * 1e-9 : 0.;
+
+  // Stopping the simulation ends the controller's loop
+  for(int i = 0; i < 10 and ros::ok(); i++){
+    PublishInfo(infoPublisher, simulationTime, false);
+    ros::spinOnce();
+    usleep(100000);
+  }
+
+  if(controllerPid > 0){
+    int status;
+    if(waitpid(controllerPid, &status, WNOHANG) == 0){
+      printf("Controller still running, stopping it\n");
+      kill(controllerPid, SIGINT);
+      waitpid(controllerPid, &status, 0);
+    }
+  }
+
+  PrintReport(elapsed > 0. ? elapsed : 1.);
+
+  ros::shutdown();
+  return 0;
+}
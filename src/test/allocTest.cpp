@@ -0,0 +1,184 @@
+#include <stdio.h>
+#include <math.h>
+
+#include "../BotController.h"
+#include "../Telemetry.h"
+#include "../AllocTracker.h"
+
+#include "vrep_common/JointSetStateData.h"
+
+//===========================================================================
+// Steady state allocation test
+//
+//   botAllocTest
+//
+// Drives one BotController through a repeating script of omni frames,
+// heading swings and proximity hits, staged the way botPatternFormation
+// stages its control loop, and fails if decode, fuse, the FSM, filling the
+// actuator messages or the telemetry text allocate once the first pass of
+// the script is over. This is the --alloc-strict check without V-REP (the
+// messages are filled but not published); it needs BOT_ALLOC_TRACKING.
+//===========================================================================
+
+#ifndef BOT_ALLOC_TRACKING
+#error botAllocTest must be built with BOT_ALLOC_TRACKING
+#endif
+
+static const float kTickSeconds = 0.05;
+static const int kTicksPerFrame = 2;      // camera slower than the loop
+static const int kPhaseTicks = 40;
+static const int kScriptTicks = 4*kPhaseTicks;
+static const int kMeasuredPasses = 5;
+
+static const int kDatumPerBlob = 6;
+static const int kMaxSegmentBlobs = 2;
+
+// Built once and refilled in place every tick, as botPatternFormation's
+// InitActuatorMessages and SetWheelSpeeds/SetServoPosition do
+static vrep_common::JointSetStateData wheelSpeedMsg;
+static vrep_common::JointSetStateData servoMsg;
+
+static void InitActuatorMessages(){
+  wheelSpeedMsg.handles.data.resize(2);
+  wheelSpeedMsg.setModes.data.resize(2);
+  wheelSpeedMsg.values.data.resize(2);
+  wheelSpeedMsg.handles.data[0] = 1;
+  wheelSpeedMsg.handles.data[1] = 2;
+  wheelSpeedMsg.setModes.data[0] = 2;
+  wheelSpeedMsg.setModes.data[1] = 2;
+
+  servoMsg.handles.data.resize(1);
+  servoMsg.setModes.data.resize(1);
+  servoMsg.values.data.resize(1);
+  servoMsg.handles.data[0] = 3;
+  servoMsg.setModes.data[0] = 1;
+  servoMsg.values.data[0] = kServoOpenPosition;
+}
+
+// One segment's packet with a blob at each of the given local bearings
+static int BuildPacket(float* packet, const float* bearings, int count){
+  packet[kOmniBlobCountIndex] = count;
+  packet[kOmniDatumPerBlobIndex] = kDatumPerBlob;
+  for(int i = 0; i < count; i++){
+    packet[i*kDatumPerBlob + kOmniBlobXOffset] = 0.25*cos(bearings[i]);
+    packet[i*kDatumPerBlob + kOmniBlobYOffset] = 0.25*sin(bearings[i]);
+    packet[i*kDatumPerBlob + kOmniBlobWidthOffset] = 0.1;
+    packet[i*kDatumPerBlob + kOmniBlobHeightOffset] = 0.1;
+  }
+  return 3 + count*kDatumPerBlob;
+}
+
+// The script: team mates ahead, then ahead and behind, then behind, then
+// nobody but a proximity hit, with the heading swinging through the
+// alignment threshold all along
+static void Sense(BotController& controller, int tick){
+  ALLOC_STAGE(STAGE_DECODE);
+
+  float time = tick*kTickSeconds;
+  int phase = (tick / kPhaseTicks) % 4;
+  controller.SetSimulationTime(time);
+  controller.BodyOrientation(0.6*sin(0.5*time));
+
+  if(phase == 3 and tick % kPhaseTicks == 0)
+    controller.FrontProximity();
+
+  if(tick % kTicksPerFrame != 0)
+    return;
+
+  float drift = 0.05*sin(time);
+  float ahead[kMaxSegmentBlobs];
+  float behind[kMaxSegmentBlobs];
+  float side[kMaxSegmentBlobs];
+  ahead[0] = drift;
+  ahead[1] = 0.3 + drift;
+  behind[0] = -drift;
+  behind[1] = -0.2 - drift;
+  side[0] = 0.5 + drift;
+  side[1] = 0.;
+  float packet[3 + kMaxSegmentBlobs*kDatumPerBlob];
+  int length;
+
+  length = BuildPacket(packet, ahead, phase <= 1 ? 2 : 0);
+  controller.OmniPacket(OMNI_FRONT, packet, length);
+  length = BuildPacket(packet, behind, phase == 1 or phase == 2 ? 2 : 0);
+  controller.OmniPacket(OMNI_BACK, packet, length);
+  length = BuildPacket(packet, side, phase == 0 ? 1 : 0);
+  controller.OmniPacket(OMNI_RIGHT, packet, length);
+  length = BuildPacket(packet, side, 0);
+  controller.OmniPacket(OMNI_LEFT, packet, length);
+}
+
+static void Tick(BotController& controller, char* text, int textSize){
+  AllocTrackerSetStage(STAGE_FUSE);
+  controller.FuseSensors();
+
+  AllocTrackerSetStage(STAGE_FSM);
+  controller.UpdateBehaviour();
+  controller.ExecuteBehaviour();
+
+  AllocTrackerSetStage(STAGE_ACTUATE);
+  servoMsg.values.data[0] = controller.GetServoPosition();
+  wheelSpeedMsg.values.data[0] = controller.GetLeftMotorSpeed();
+  wheelSpeedMsg.values.data[1] = controller.GetRightMotorSpeed();
+
+  AllocTrackerSetStage(STAGE_TELEMETRY);
+  FormatTelemetry(text, textSize, controller);
+
+  AllocTrackerSetStage(STAGE_OTHER);
+  controller.ClearProximity();
+}
+
+//===========================================================================
+// Main Function
+//===========================================================================
+int main(){
+  static const int checked[] = {STAGE_DECODE, STAGE_FUSE, STAGE_FSM, STAGE_ACTUATE,
+				STAGE_TELEMETRY};
+  static const char* checkedNames[] = {"decode", "fuse", "fsm", "actuate", "telemetry"};
+  static const int numChecked = 5;
+
+  BotController controller;
+  char text[2048];
+
+  InitActuatorMessages();
+  AllocTrackerInit();
+
+  // Warm up: the first pass grows every buffer to the size the script
+  // needs, which is allowed
+  int tick = 0;
+  for(; tick < kScriptTicks; tick++){
+    Sense(controller, tick);
+    Tick(controller, text, sizeof(text));
+  }
+
+  unsigned long before[numChecked];
+  for(int i = 0; i < numChecked; i++)
+    before[i] = AllocTrackerCount(checked[i]);
+  long transitionsBefore = controller.GetStateManager()->GetTransitionCount();
+
+  for(; tick < (1 + kMeasuredPasses)*kScriptTicks; tick++){
+    Sense(controller, tick);
+    Tick(controller, text, sizeof(text));
+  }
+
+  long transitions = controller.GetStateManager()->GetTransitionCount() - transitionsBefore;
+  int failures = 0;
+
+  printf("%d steady state ticks, %ld state transitions\n",
+	 kMeasuredPasses*kScriptTicks, transitions);
+  for(int i = 0; i < numChecked; i++){
+    unsigned long count = AllocTrackerCount(checked[i]) - before[i];
+    printf("  %-10s %lu allocations\n", checkedNames[i], count);
+    if(count != 0)
+      failures++;
+  }
+
+  // Without transitions the FSM's part of the test proves nothing
+  if(transitions < kMeasuredPasses){
+    printf("FAIL: the script should change state at least once a pass\n");
+    failures++;
+  }
+
+  printf("%s\n", failures == 0 ? "PASS" : "FAIL");
+  return failures == 0 ? 0 : 1;
+}
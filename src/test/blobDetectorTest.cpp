@@ -0,0 +1,317 @@
+#include <stdio.h>
+#include <math.h>
+#include <string.h>
+#include <vector>
+#include <algorithm>
+
+#include "../BlobDetector.h"
+
+using namespace std;
+
+//===========================================================================
+// Blob detector test
+//
+//   botBlobDetectorTest
+//
+// Checks the SSE2 ThresholdRow against ThresholdRowScalar on random rows of
+// every width up to a few registers, that Detect reports positions and
+// orientation in the blob filter's convention, from the bottom left with
+// y up, that the run based labelling finds the same components as a pixel
+// flood fill, and that the pyramid levels find compact markers exactly as
+// full resolution does. Exits non-zero on a failure.
+//===========================================================================
+
+static const float kTolerance = 1e-4;
+
+static int failures = 0;
+static unsigned int randomState = 1;
+
+static void Check(bool ok, const char* what){
+  if(not ok){
+    printf("  FAIL: %s\n", what);
+    failures++;
+  }
+}
+
+static bool Near(float value, float expected){
+  return fabs(value - expected) < kTolerance;
+}
+
+static unsigned int Random(){
+  randomState ^= randomState << 13;
+  randomState ^= randomState >> 17;
+  randomState ^= randomState << 5;
+  return randomState;
+}
+
+// Black image with the pixels of a width x height rectangle at x, y (row
+// order) set to the marker red
+static void FillRect(vector<uint8_t>& image, int imageWidth, int x, int y,
+		     int width, int height){
+  for(int row = y; row < y + height; row++){
+    for(int column = x; column < x + width; column++){
+      uint8_t* pixel = &image[3*(row*imageWidth + column)];
+      pixel[0] = 200;
+      pixel[1] = 30;
+      pixel[2] = 30;
+    }
+  }
+}
+
+// Packet of a mask, in Detect's layout and component order, found by
+// flood filling 8-connected pixels from each unvisited one in raster
+// order. A blob with no major axis gets a NAN orientation, as rounding
+// in the moments decides it.
+static void FloodFillPacket(const vector<uint8_t>& set, int width, int height,
+			    vector<float>& packet){
+  packet.assign(kBlobPacketHeader, 0.);
+  packet[1] = kBlobPacketDatum;
+  vector<uint8_t> seen(width*height, 0);
+  vector<int> stack;
+  int blobs = 0;
+
+  for(int start = 0; start < width*height; start++){
+    if(not set[start] or seen[start])
+      continue;
+    double area = 0., sumX = 0., sumY = 0., sumXX = 0., sumYY = 0., sumXY = 0.;
+    int minX = width, maxX = -1, minY = height, maxY = -1;
+    seen[start] = 1;
+    stack.push_back(start);
+    while(not stack.empty()){
+      int pixel = stack.back();
+      stack.pop_back();
+      int x = pixel % width;
+      int y = pixel / width;
+      area += 1.;
+      sumX += x;
+      sumY += y;
+      sumXX += (double)x*x;
+      sumYY += (double)y*y;
+      sumXY += (double)x*y;
+      minX = min(minX, x);
+      maxX = max(maxX, x);
+      minY = min(minY, y);
+      maxY = max(maxY, y);
+      for(int dy = -1; dy <= 1; dy++){
+	for(int dx = -1; dx <= 1; dx++){
+	  int nx = x + dx;
+	  int ny = y + dy;
+	  if(nx < 0 or ny < 0 or nx >= width or ny >= height)
+	    continue;
+	  int next = ny*width + nx;
+	  if(set[next] and not seen[next]){
+	    seen[next] = 1;
+	    stack.push_back(next);
+	  }
+	}
+      }
+    }
+
+    double cx = sumX / area;
+    double cy = sumY / area;
+    double mu20 = sumXX / area - cx*cx;
+    double mu02 = sumYY / area - cy*cy;
+    double mu11 = sumXY / area - cx*cy;
+    packet.push_back(area / ((double)width*height));
+    if(fabs(2.*mu11) + fabs(mu20 - mu02) < 1e-6)
+      packet.push_back(NAN);
+    else
+      packet.push_back(-0.5 * atan2(2.*mu11, mu20 - mu02));
+    packet.push_back((cx + 0.5) / width);
+    packet.push_back(1. - (cy + 0.5) / height);
+    packet.push_back((maxX - minX + 1) / (float)width);
+    packet.push_back((maxY - minY + 1) / (float)height);
+    blobs++;
+  }
+  packet[0] = blobs;
+}
+
+// Same blobs in the same order, skipping the expected NANs
+static bool SamePackets(const vector<float>& packet, const vector<float>& expected){
+  if(packet.size() != expected.size() or packet[0] != expected[0])
+    return false;
+  for(int i = kBlobPacketHeader; i < (int)packet.size(); i++){
+    if(not isnan(expected[i]) and not Near(packet[i], expected[i]))
+      return false;
+  }
+  return true;
+}
+
+// Blobs of a packet as rows, sorted by position, for comparing passes
+// that find the same blobs in a different order
+static vector<vector<float> > SortedBlobs(const vector<float>& packet){
+  vector<vector<float> > blobs;
+  for(int i = kBlobPacketHeader; i + kBlobPacketDatum <= (int)packet.size(); i += kBlobPacketDatum)
+    blobs.push_back(vector<float>(packet.begin() + i, packet.begin() + i + kBlobPacketDatum));
+  sort(blobs.begin(), blobs.end());
+  return blobs;
+}
+
+//===========================================================================
+// Tests
+//===========================================================================
+
+// Pixels are drawn mostly near the colour box's faces so every channel's
+// comparison is exercised at and either side of its bounds
+static void TestThresholdRow(){
+  printf("threshold row\n");
+  BlobDetectorConfig config;
+  DefaultBlobDetectorConfig(config);
+  ThresholdPattern pattern;
+  MakeThresholdPattern(config, pattern);
+
+  const int maxWidth = 100;
+  uint8_t rgb[3*maxWidth];
+  uint8_t mask[maxWidth];
+  uint8_t reference[maxWidth];
+
+  int mismatches = 0;
+  for(int trial = 0; trial < 200; trial++){
+    for(int width = 0; width <= maxWidth; width++){
+      for(int i = 0; i < 3*width; i++){
+	int channel = i % 3;
+	int bound = Random() & 1 ? config.lower[channel] : config.upper[channel];
+	int value = Random() % 4 == 0 ? Random() & 255 : bound + (int)(Random() % 5) - 2;
+	rgb[i] = value < 0 ? 0 : (value > 255 ? 255 : value);
+      }
+      memset(mask, 2, sizeof(mask));
+      memset(reference, 2, sizeof(reference));
+      ThresholdRow(rgb, width, pattern, mask);
+      ThresholdRowScalar(rgb, width, pattern, reference);
+      if(memcmp(mask, reference, sizeof(mask)) != 0)
+	mismatches++;
+    }
+  }
+  Check(mismatches == 0, "SSE2 and scalar masks agree, and neither writes past the width");
+}
+
+// A square in the top left corner of the ROS image is near the top of the
+// blob filter's frame, so its y is close to 1
+static void TestConvention(){
+  printf("position convention\n");
+  const int size = 64;
+  vector<uint8_t> image(3*size*size, 0);
+  FillRect(image, size, 4, 2, 8, 8);
+
+  BlobDetector detector;
+  vector<float> packet;
+  Check(detector.Detect(&image[0], size, size, 3*size, packet) == 1, "one blob found");
+  if(packet.size() < kBlobPacketHeader + kBlobPacketDatum)
+    return;
+  const float* blob = &packet[kBlobPacketHeader];
+  Check(Near(blob[2], 8. / size), "x from the left");
+  Check(Near(blob[3], 1. - 6. / size), "y up from the bottom row");
+  Check(Near(blob[4], 8. / size) and Near(blob[5], 8. / size), "size relative to the image");
+
+  // A diagonal rising to the right, drawn going up the rows, lies at
+  // +45 degrees with y up
+  vector<uint8_t> diagonal(3*size*size, 0);
+  for(int i = 0; i < 20; i++)
+    FillRect(diagonal, size, 10 + i, 40 - i, 2, 2);
+  Check(detector.Detect(&diagonal[0], size, size, 3*size, packet) == 1, "one diagonal blob found");
+  if(packet.size() < kBlobPacketHeader + kBlobPacketDatum)
+    return;
+  Check(fabs(packet[kBlobPacketHeader + 1] - M_PI/4.) < 0.01, "orientation counter clockwise");
+}
+
+// Random masks of every shape, from specks to tangles that join rows
+// above in several places, so runs are merged out of order
+static void TestLabelling(){
+  printf("labelling\n");
+  BlobDetectorConfig config;
+  DefaultBlobDetectorConfig(config);
+  config.minArea = 1;
+  BlobDetector detector(config);
+
+  vector<uint8_t> set;
+  vector<uint8_t> image;
+  vector<float> packet;
+  vector<float> expected;
+  int mismatches = 0;
+  for(int trial = 0; trial < 500; trial++){
+    int width = 1 + Random() % 70;
+    int height = 1 + Random() % 50;
+    int density = 1 + Random() % 7;
+    set.assign(width*height, 0);
+    image.assign(3*width*height, 0);
+    for(int i = 0; i < width*height; i++){
+      if((int)(Random() % 8) < density){
+	set[i] = 1;
+	FillRect(image, width, i % width, i / width, 1, 1);
+      }
+    }
+    detector.Detect(&image[0], width, height, 3*width, packet);
+    FloodFillPacket(set, width, height, expected);
+    if(not SamePackets(packet, expected))
+      mismatches++;
+  }
+  Check(mismatches == 0, "runs label the same components as a pixel flood fill");
+}
+
+// Rectangles at least 4 pixels tall and wide, kept apart, are the compact
+// markers the header promises both coarse passes find exactly
+static void TestPyramid(){
+  printf("pyramid\n");
+  const int width = 160;
+  const int height = 120;
+  BlobDetectorConfig config;
+  DefaultBlobDetectorConfig(config);
+  BlobDetector full(config);
+  BlobDetector coarse[2];
+  for(int level = 1; level <= 2; level++){
+    config.pyramidLevels = level;
+    coarse[level - 1].SetConfig(config);
+  }
+
+  vector<uint8_t> image;
+  vector<uint8_t> taken;
+  vector<float> packet;
+  vector<float> expected;
+  int found = 0;
+  int mismatches[2] = {0, 0};
+  for(int trial = 0; trial < 300; trial++){
+    image.assign(3*width*height, 0);
+    taken.assign(width*height, 0);
+    int markers = Random() % 12;
+    for(int m = 0; m < markers; m++){
+      int w = 4 + Random() % 20;
+      int h = 4 + Random() % 20;
+      int x = Random() % (width - w + 1);
+      int y = Random() % (height - h + 1);
+      // A pixel of clearance so no two markers touch
+      bool clear = true;
+      for(int row = y - 1; row <= y + h and clear; row++)
+	for(int column = x - 1; column <= x + w and clear; column++)
+	  if(row >= 0 and row < height and column >= 0 and column < width)
+	    clear = not taken[row*width + column];
+      if(not clear)
+	continue;
+      for(int row = y; row < y + h; row++)
+	memset(&taken[row*width + x], 1, w);
+      FillRect(image, width, x, y, w, h);
+    }
+
+    found += full.Detect(&image[0], width, height, 3*width, expected);
+    for(int level = 1; level <= 2; level++){
+      coarse[level - 1].Detect(&image[0], width, height, 3*width, packet);
+      if(packet[0] != expected[0] or SortedBlobs(packet) != SortedBlobs(expected))
+	mismatches[level - 1]++;
+    }
+  }
+  Check(found > 0, "markers are found at full resolution");
+  Check(mismatches[0] == 0, "level 1 finds the markers as full resolution does");
+  Check(mismatches[1] == 0, "level 2 finds the markers as full resolution does");
+}
+
+//===========================================================================
+// Main Function
+//===========================================================================
+int main(){
+  TestThresholdRow();
+  TestConvention();
+  TestLabelling();
+  TestPyramid();
+
+  printf("%s\n", failures == 0 ? "PASS" : "FAIL");
+  return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,159 @@
+#include <stdio.h>
+#include <math.h>
+
+#include "../DriveOutput.h"
+
+//===========================================================================
+// DriveOutput limits test
+//
+//   botDriveOutputTest
+//
+// Checks the output stage's three limits against hand worked numbers:
+// saturation scales both wheels by one factor so the turning ratio holds,
+// the acceleration limit ramps both wheels with one shared factor, and the
+// servo moves no faster than its slew rate. Exits non-zero on a failure.
+//===========================================================================
+
+static const float kTickSeconds = 0.05;
+static const float kTolerance = 1e-4;
+
+static int failures = 0;
+
+static void Check(bool ok, const char* what){
+  if(not ok){
+    printf("  FAIL: %s\n", what);
+    failures++;
+  }
+}
+
+static bool Near(float value, float expected){
+  return fabs(value - expected) < kTolerance;
+}
+
+//===========================================================================
+// Tests
+//===========================================================================
+
+// trans 5, rot 8 asks for left 9, right 1. With wheels limited to 8 both
+// are scaled by 8/9, keeping the 9:1 ratio, instead of clipping the left
+// wheel alone and turning less sharply.
+static void TestSaturation(){
+  printf("saturation\n");
+  DriveOutput output;
+  output.SetLimits(8., 0., 0.);
+
+  output.Update(5., 8., true, 0.);
+  Check(Near(output.GetLeftSpeed(), 8.), "faster wheel is held at the limit");
+  Check(Near(output.GetRightSpeed(), 8./9.), "slower wheel is scaled by the same factor");
+  Check(Near(output.GetLeftSpeed() / output.GetRightSpeed(), 9.), "turning ratio is kept");
+  Check(output.GetSaturatedCount() == 1, "saturated update is counted");
+
+  output.Update(2., 1., true, kTickSeconds);
+  Check(Near(output.GetLeftSpeed(), 2.5) and Near(output.GetRightSpeed(), 1.5),
+	"command within the limit passes unchanged");
+  Check(output.GetSaturatedCount() == 1, "unsaturated update is not counted");
+
+  output.Update(-5., -8., true, 2.*kTickSeconds);
+  Check(Near(output.GetLeftSpeed(), -8.) and Near(output.GetRightSpeed(), -8./9.),
+	"reverse saturates symmetrically");
+}
+
+// At 50 per second and 0.05 s a tick a wheel may change by 2.5 a tick.
+// From rest to left 6, right 4 the left wheel sets the pace and the right
+// follows with the same fraction of its change, so the pair ramps along
+// the 3:2 line and arrives together on the third tick.
+static void TestAcceleration(){
+  printf("acceleration\n");
+  DriveOutput output;
+  output.SetLimits(0., 50., 0.);
+
+  output.Update(0., 0., true, 0.);
+
+  float expectedLeft[] = {2.5, 5., 6.};
+  float expectedRight[] = {2.5*4./6., 5.*4./6., 4.};
+  for(int i = 0; i < 3; i++){
+    output.Update(5., 2., true, (i + 1)*kTickSeconds);
+    Check(Near(output.GetLeftSpeed(), expectedLeft[i]), "left wheel ramps at the limit");
+    Check(Near(output.GetRightSpeed(), expectedRight[i]), "right wheel ramps by the shared factor");
+    Check(Near(output.GetLeftSpeed() * 4., output.GetRightSpeed() * 6.),
+	  "ramp keeps the ratio of the change");
+  }
+  Check(output.GetAccelLimitedCount() == 2, "only the cut updates are counted");
+
+  // Reversing from 5 to -2.5 on both wheels passes through zero a step
+  // at a time
+  output.Reset();
+  output.Update(5., 0., true, 0.);
+  float expectedReverse[] = {2.5, 0., -2.5, -2.5};
+  for(int i = 0; i < 4; i++){
+    output.Update(-2.5, 0., true, (i + 1)*kTickSeconds);
+    Check(Near(output.GetLeftSpeed(), expectedReverse[i]) and
+	  Near(output.GetRightSpeed(), expectedReverse[i]), "reversal ramps through zero");
+  }
+}
+
+// At 6 rad/s and 0.05 s a tick the servo moves 0.3 rad a tick, so closing
+// from open takes eleven ticks to cover pi
+static void TestServoSlew(){
+  printf("servo slew\n");
+  DriveOutput output;
+  output.SetLimits(0., 0., 6.);
+
+  output.Update(0., 0., true, 0.);
+  Check(Near(output.GetServoPosition(), kServoOpenPosition), "starts open");
+
+  float last = output.GetServoPosition();
+  int ticks = 0;
+  while(ticks < 20 and not Near(output.GetServoPosition(), kServoClosedPosition)){
+    ticks++;
+    output.Update(0., 0., false, ticks*kTickSeconds);
+    float step = output.GetServoPosition() - last;
+    Check(step > 0. and step <= 0.3 + kTolerance, "servo steps towards closed within the slew rate");
+    last = output.GetServoPosition();
+  }
+  Check(ticks == 11, "servo closes in ceil(pi / 0.3) ticks");
+
+  ticks++;
+  output.Update(0., 0., true, ticks*kTickSeconds);
+  Check(Near(output.GetServoPosition(), kServoClosedPosition - 0.3), "reopening is slewed too");
+}
+
+// The first update and any that goes back in time have no interval to
+// limit over, and a limit of 0 is no limit
+static void TestPassthrough(){
+  printf("passthrough\n");
+  DriveOutput output;
+  output.SetLimits(0., 50., 6.);
+
+  output.Update(5., 2., false, 1.);
+  Check(Near(output.GetLeftSpeed(), 6.) and Near(output.GetRightSpeed(), 4.),
+	"first update is not ramped");
+  Check(Near(output.GetServoPosition(), kServoClosedPosition), "first update is not slewed");
+
+  output.Update(-5., 0., true, 0.5);
+  Check(Near(output.GetLeftSpeed(), -5.) and Near(output.GetRightSpeed(), -5.),
+	"update back in time is not ramped");
+  Check(Near(output.GetServoPosition(), kServoOpenPosition), "update back in time is not slewed");
+
+  DriveOutput unlimited;
+  unlimited.Update(0., 0., true, 0.);
+  unlimited.Update(100., 40., false, kTickSeconds);
+  Check(Near(unlimited.GetLeftSpeed(), 120.) and Near(unlimited.GetRightSpeed(), 80.),
+	"zero limits pass the command through");
+  Check(Near(unlimited.GetServoPosition(), kServoClosedPosition), "zero slew rate moves at once");
+  Check(unlimited.GetSaturatedCount() == 0 and unlimited.GetAccelLimitedCount() == 0,
+	"nothing is counted without limits");
+}
+
+//===========================================================================
+// Main Function
+//===========================================================================
+int main(){
+  TestSaturation();
+  TestAcceleration();
+  TestServoSlew();
+  TestPassthrough();
+
+  printf("%s\n", failures == 0 ? "PASS" : "FAIL");
+  return failures == 0 ? 0 : 1;
+}